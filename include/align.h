@@ -0,0 +1,124 @@
+/*
+Streaming alignment output.
+
+Matches are written as they are produced, either as 1-based "i j" index
+pairs or as a CIGAR-like run-length edit script ('=' match, 'X' aligned
+mismatch, 'D' symbol of X only, 'I' symbol of Y only). Matches must arrive
+in left-to-right order; engines that trace back right-to-left spool them
+with align_spool() and replay the spool backwards in fixed-size chunks, so
+the alignment is never held in memory. Positions are 64-bit throughout.
+*/
+
+#include <stdio.h>
+
+#define SPOOL_CHUNK 4096
+
+FILE *align_fp;
+FILE *align_spool_fp;
+int align_cigar;
+
+long long align_pi, align_pj;
+char align_op;
+long long align_cnt;
+
+int align_open(const char *fname, int cigar) {
+    if (align_fp != NULL) fclose(align_fp);
+    if ((align_fp = fopen(fname, "w")) == NULL) return 0;
+    align_cigar = cigar;
+    return 1;
+}
+
+void align_close(void) {
+    if (align_spool_fp != NULL) fclose(align_spool_fp);
+    if (align_fp != NULL) fclose(align_fp);
+    align_spool_fp = NULL;
+    align_fp = NULL;
+}
+
+void align_flush_op(void) {
+    if (align_cnt > 0) fprintf(align_fp, "%lld%c", align_cnt, align_op);
+    align_cnt = 0;
+}
+
+void align_emit_op(char op, long long cnt) {
+    if (cnt <= 0) return;
+    if (op != align_op) {
+        align_flush_op();
+        align_op = op;
+    }
+    align_cnt += cnt;
+}
+
+void align_begin(int r) {
+    align_pi = align_pj = 0;
+    align_op = 0;
+    align_cnt = 0;
+    fprintf(align_fp, "# pair %d\n", r + 1);
+}
+
+void align_pair(long long i, long long j, char op) {
+    if (align_cigar) {
+        align_emit_op('D', i - align_pi - 1);
+        align_emit_op('I', j - align_pj - 1);
+        align_emit_op(op, 1);
+    } else if (op == '=')
+        fprintf(align_fp, "%lld %lld\n", i, j);
+    else
+        fprintf(align_fp, "%lld %lld %c\n", i, j, op);
+
+    align_pi = i;
+    align_pj = j;
+}
+
+void align_match(long long i, long long j) { align_pair(i, j, '='); }
+
+void align_mismatch(long long i, long long j) { align_pair(i, j, 'X'); }
+
+void align_end(long long m, long long n) {
+    if (align_cigar) {
+        align_emit_op('D', m - align_pi);
+        align_emit_op('I', n - align_pj);
+        align_flush_op();
+        fprintf(align_fp, "\n");
+    }
+    fflush(align_fp);
+}
+
+/*
+Right-to-left producers: matches go to a binary spool, replayed by
+align_replay(). A negative row marks an aligned mismatch.
+*/
+int align_spool_begin(void) {
+    if (align_spool_fp == NULL) align_spool_fp = tmpfile();
+    if (align_spool_fp == NULL) return 0;
+    rewind(align_spool_fp);
+    return 1;
+}
+
+void align_spool(long long i, long long j) {
+    long long p[2];
+
+    p[0] = i;
+    p[1] = j;
+    fwrite(p, sizeof(long long), 2, align_spool_fp);
+}
+
+void align_replay(void) {
+    long long buf[2 * SPOOL_CHUNK];
+    long end, start, k;
+
+    end = ftell(align_spool_fp) / (2 * sizeof(long long));
+
+    while (end > 0) {
+        start = (end > SPOOL_CHUNK) ? end - SPOOL_CHUNK : 0;
+        fseek(align_spool_fp, start * 2 * sizeof(long long), SEEK_SET);
+        if (fread(buf, 2 * sizeof(long long), end - start, align_spool_fp) != (size_t)(end - start)) break;
+        for (k = end - start - 1; k >= 0; k--) {
+            if (buf[2 * k] < 0)
+                align_mismatch(-buf[2 * k], buf[2 * k + 1]);
+            else
+                align_match(buf[2 * k], buf[2 * k + 1]);
+        }
+        end = start;
+    }
+}
@@ -0,0 +1,112 @@
+/*
+Alphabet coding: the symbols of the "alphabet:" header (or, without one,
+those of the pairs) get dense codes 0 .. size - 1 in an alpha_map, and
+a symbol outside the header is an input error. Alphabets of up to
+ALPHA_MAX_KERNEL symbols select a match-mask row kernel, instantiated for
+2, 4 and 32 codes: a DP row of XX against YY is advanced a whole word of
+columns per operation (bit-parallel LCS, one mask per code over YY), and
+decoded to the scores ALG_B would produce. Each lcs_ctx
+(include/lcs_ctx.h) points at the map its kernels use.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#define ALPHA_AUTO 0
+#define ALPHA_OFF 1
+
+#define ALPHA_KERNELS 4
+#define ALPHA_MAX_KERNEL 32
+
+const char *alpha_names[] = {"auto", "off"};
+int alpha_mode = ALPHA_OFF;  // the binaries opt in with --alphabet=auto, so benchmarks compare plain DP
+
+const int alpha_sizes[ALPHA_KERNELS] = {0, 2, 4, ALPHA_MAX_KERNEL};
+
+struct alpha_map {
+    short code[256];  // -1 for a symbol outside the alphabet
+    int size;
+    int kernel;  // alpha_sizes slot, 0 for the plain DP compare
+};
+
+int alpha_derived;  // no header: the alphabet is the symbols of the pairs
+
+void alpha_reset(struct alpha_map *a) {
+    int c;
+
+    for (c = 0; c < 256; c++) a->code[c] = -1;
+    a->size = 0;
+}
+
+/* Adds the symbols of s[0..n) not coded yet, in order of first appearance. */
+void alpha_add(struct alpha_map *a, const char *s, INDEX_TYPE n) {
+    INDEX_TYPE i;
+
+    for (i = 0; i < n; i++)
+        if (a->code[(unsigned char)s[i]] < 0) a->code[(unsigned char)s[i]] = a->size++;
+}
+
+/* First position of s[0..n) outside the alphabet, -1 if there is none. */
+INDEX_TYPE alpha_find(const struct alpha_map *a, const char *s, INDEX_TYPE n) {
+    INDEX_TYPE i;
+
+    for (i = 0; i < n; i++)
+        if (a->code[(unsigned char)s[i]] < 0) return i;
+
+    return -1;
+}
+
+void alpha_select(struct alpha_map *a, int mode) {
+    for (a->kernel = 1; a->kernel < ALPHA_KERNELS; a->kernel++)
+        if (a->size <= alpha_sizes[a->kernel]) break;
+
+    if ((a->kernel == ALPHA_KERNELS) || (mode == ALPHA_OFF)) a->kernel = 0;
+}
+
+/* Words of masks alpha_row needs for rows of n columns. */
+INDEX_TYPE alpha_words(const struct alpha_map *a, INDEX_TYPE n) { return (alpha_sizes[a->kernel] + 1) * ((n + 63) >> 6); }
+
+/*
+LL[0..n] = the LCS of XX[0..m) against YY[0..j) for every j, with SIGMA
+masks over YY (in M, alpha_words of them). Bit j of the row is 0 iff the
+score steps up at column j + 1 (Allison-Dix / Hyyro), so a row is one add
+and three logic ops per word.
+*/
+template <int SIGMA, class P, class V>
+int alpha_rows(const struct alpha_map *a, INDEX_TYPE m, INDEX_TYPE n, P XX, P YY, V *LL, uint64_t *M) {
+    INDEX_TYPE i, j, w, nw = (n + 63) >> 6;
+    uint64_t *R, *Mx, r, u, s, c;
+
+    if (nw == 0) return 0;
+    R = M + SIGMA * nw;
+
+    memset(M, 0, SIGMA * nw * sizeof(uint64_t));
+    for (j = 0; j < n; j++) M[a->code[(unsigned char)YY[j]] * nw + (j >> 6)] |= 1ULL << (j & 63);
+    for (w = 0; w < nw; w++) R[w] = ~0ULL;
+
+    for (i = 0; i < m; i++) {
+        Mx = M + a->code[(unsigned char)XX[i]] * nw;
+        for (w = 0, c = 0; w < nw; w++) {
+            r = R[w];
+            u = r & Mx[w];
+            s = r + u + c;
+            c = (s < r) || (c && (s == r));
+            R[w] = s | (r - u);
+        }
+    }
+
+    LL[0] = 0;
+    for (j = 1; j <= n; j++) LL[j] = LL[j - 1] + (V)(((R[(j - 1) >> 6] >> ((j - 1) & 63)) & 1) ^ 1);
+
+    return 1;
+}
+
+/* alpha_rows for the selected kernel; returns 0 if there is none. XX and YY are pointers or reverse iterators. */
+template <class P, class V>
+int alpha_row(const struct alpha_map *a, INDEX_TYPE m, INDEX_TYPE n, P XX, P YY, V *LL, uint64_t *M) {
+    static int (*const rows[ALPHA_KERNELS])(const struct alpha_map *, INDEX_TYPE, INDEX_TYPE, P, P, V *,
+                                            uint64_t *) = {NULL, alpha_rows<2, P, V>, alpha_rows<4, P, V>,
+                                                           alpha_rows<ALPHA_MAX_KERNEL, P, V>};
+
+    return (sizeof(*XX) == 1) && (a->kernel > 0) && rows[a->kernel](a, m, n, XX, YY, LL, M);
+}
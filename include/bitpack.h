@@ -0,0 +1,121 @@
+/*
+Bit-packed DP boundaries.
+
+A snapshot of rlen over the diagonals b - w .. b + h of a swept h x w block
+runs down its right column and then back along its bottom row (an input
+boundary runs along the top row and down the left column), so for LCS
+consecutive entries differ by 0 or by one fixed +-1 on each side of the
+corner. Such a segment packs to one bit per step plus an absolute value
+every PACK_BLOCK entries; anything else (edit or weighted scores, or a
+corner past PACK_MAX_CORNER) is kept raw behind the same one-word header.
+
+  word 0                     PACK_RAW, or the sign bits of the two sides and,
+                             from bit PACK_CORNER_SHIFT, the step at the corner
+  per block of PACK_BLOCK    the block's first value, then PACK_BLOCK / 32
+                             words with bit t set iff entry t differs from t - 1
+*/
+
+#define PACK_BLOCK 256
+#define PACK_WORDS (PACK_BLOCK / 32)
+
+#define PACK_RAW 4
+#define PACK_NEG_LO 1
+#define PACK_NEG_HI 2
+#define PACK_CORNER_SHIFT 3
+#define PACK_MAX_CORNER ((1LL << (31 - PACK_CORNER_SHIFT)) - 1)
+
+int pack_on = 1;
+
+// segments packed and kept raw, and their bytes against the int size
+struct pack_stats {
+    long long cnt, raw_cnt;
+    double bytes, raw_bytes, in_bytes;
+};
+
+/* Words needed for a segment of len entries in the worst (raw) case. */
+INDEX_TYPE pack_max_words(INDEX_TYPE len) { return len + 1; }
+
+/* Words of the packed form of len entries. */
+INDEX_TYPE pack_words(INDEX_TYPE len) { return 1 + ((len + PACK_BLOCK - 1) / PACK_BLOCK) * (1 + PACK_WORDS); }
+
+/* Packs v[0..len) (int or uint16_t scores) into out, counted in st unless it is NULL; returns the words written. */
+template <class V>
+INDEX_TYPE pack_boundary(const V *v, INDEX_TYPE len, int *out, struct pack_stats *st) {
+    INDEX_TYPE i, c = 0;
+    int d, s[2] = {0, 0}, h = 0;
+    unsigned *w = NULL;
+
+    // steps before c take sign s[0], the rest s[1]; c is the first step against s[0], or 0 if none is
+    for (i = 1; i < len; i++) {
+        d = v[i] - v[i - 1];
+        if (d == 0) continue;
+        if ((d != 1) && (d != -1)) break;
+        if (s[h] == 0)
+            s[h] = d;
+        else if (s[h] != d) {
+            if (h == 1) break;
+            h = 1;
+            s[1] = d;
+            c = i - 1;
+        }
+    }
+    if (h == 0) s[1] = s[0];
+
+    if (st != NULL) st->in_bytes += len * sizeof(int);
+
+    if (!pack_on || (i < len) || (c > PACK_MAX_CORNER) || (pack_words(len) >= len + 1)) {
+        out[0] = PACK_RAW;
+        for (i = 0; i < len; i++) out[i + 1] = v[i];
+        if (st != NULL) {
+            st->raw_cnt++;
+            st->raw_bytes += (len + 1) * sizeof(int);
+        }
+        return len + 1;
+    }
+
+    out[0] = ((s[0] < 0) ? PACK_NEG_LO : 0) | ((s[1] < 0) ? PACK_NEG_HI : 0) | (int)(c << PACK_CORNER_SHIFT);
+
+    for (i = 0; i < len; i++) {
+        if ((i % PACK_BLOCK) == 0) {
+            w = (unsigned *)out + 1 + (i / PACK_BLOCK) * (1 + PACK_WORDS);
+            w[0] = v[i];
+            memset(w + 1, 0, PACK_WORDS * sizeof(unsigned));
+        } else if (v[i] != v[i - 1])
+            w[1 + (i % PACK_BLOCK) / 32] |= 1u << (i % 32);
+    }
+
+    if (st != NULL) {
+        st->cnt++;
+        st->bytes += pack_words(len) * sizeof(int);
+    }
+
+    return pack_words(len);
+}
+
+/* Unpacks len entries from in into v. */
+template <class V>
+void unpack_boundary(const int *in, INDEX_TYPE len, V *v) {
+    INDEX_TYPE i, c, e;
+    int lo, hi;
+    const unsigned *w;
+    unsigned m;
+
+    if (in[0] == PACK_RAW) {
+        for (i = 0; i < len; i++) v[i] = in[i + 1];
+        return;
+    }
+
+    lo = (in[0] & PACK_NEG_LO) ? -1 : 1;
+    hi = (in[0] & PACK_NEG_HI) ? -1 : 1;
+    c = in[0] >> PACK_CORNER_SHIFT;
+
+    for (i = 0; i < len; i += PACK_BLOCK) {
+        w = (const unsigned *)in + 1 + (i / PACK_BLOCK) * (1 + PACK_WORDS);
+        v[i] = (V)w[0];
+        e = (i + PACK_BLOCK < len) ? i + PACK_BLOCK : len;
+        for (INDEX_TYPE t = i + 1; t < e; t++) {
+            m = (w[1 + (t - i) / 32] >> (t % 32)) & 1u;
+            v[t] = (V)(v[t - 1] + (int)m * ((t - 1 < c) ? lo : hi));
+        }
+    }
+}
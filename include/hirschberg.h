@@ -0,0 +1,345 @@
+/*
+Hirschberg's ALG_B and ALG_C on an lcs_ctx (include/lcs_ctx.h), shared by
+lcs_hirschberg and liblcs. ALG_C reads X and Y forwards (XX, YY) and
+reversed (XXR, YYR: reversed copies in lcs_hirschberg, reverse iterators
+over the caller's buffers in liblcs), appends the LCS to Z from Z[zp + 1] and its matches
+through lcs_emit(), and takes its rows from L1, L2, K and clen; the
+cache-aware strips (tile_col) and the single-pass splits (kw_rows) are used
+when the context has them.
+*/
+
+#define SPLIT_CLASSIC 0
+#define SPLIT_SINGLE 1
+#define SPLIT_KWAY 2
+
+/* Advance LL by the rows XX[0], XX[d], ..., XX[(rows - 1) d] against YY[0..n). */
+template <class T, class V>
+void row_advance(T *XX, INDEX_TYPE rows, int d, T *YY, INDEX_TYPE n, V *LL) {
+    INDEX_TYPE i, j;
+    int u, v;
+
+    for (i = 0; i < rows; i++, XX += d) {
+        for (j = 1, u = 0; j <= n; j++) {
+            v = LL[j];
+            if (*XX == YY[j - 1])
+                LL[j] = u + 1;
+            else if (LL[j - 1] > v)
+                LL[j] = LL[j - 1];
+            u = v;
+        }
+    }
+}
+
+/*
+Cache-aware ALG_B: the columns are swept in strips of tile_w, each over all
+m rows. The strip's part of the row stays in LL[j0 .. j1] (in cache), and
+the column just left of it comes from tile_col, which the strip then
+overwrites with its own last column for the next strip. A pass costs
+O(m n / (w B)) misses instead of O(m n / B) once a row outgrows the cache,
+and LL ends up as in ALG_B.
+*/
+template <class P, class V>
+void ALG_B_tiled(struct lcs_ctx *c, INDEX_TYPE m, INDEX_TYPE n, P XX, P YY, V *LL) {
+    INDEX_TYPE i, j, j0, j1;
+    int u, v, d, l;
+    V *C = (V *)c->tile_col;
+    typename std::iterator_traits<P>::value_type x;
+
+    for (i = 0; i <= m; i++) C[i] = 0;
+    LL[0] = 0;
+
+    for (j0 = 1; j0 <= n; j0 = j1 + 1) {
+        j1 = min(j0 + c->tile_w - 1, n);
+
+        for (j = j0; j <= j1; j++) LL[j] = 0;
+
+        for (i = 1, u = C[0]; i <= m; i++) {
+            x = XX[i - 1];
+            d = u;
+            l = C[i];
+            u = l;
+            for (j = j0; j <= j1; j++) {
+                v = LL[j];
+                if (x == YY[j - 1])
+                    l = d + 1;
+                else if (v > l)
+                    l = v;
+                LL[j] = l;
+                d = v;
+            }
+            C[i] = l;
+        }
+    }
+}
+
+/* XX and YY are pointers, or reverse iterators over them for the backward scans of ALG_C. */
+template <class P, class V>
+void ALG_B(struct lcs_ctx *c, INDEX_TYPE m, INDEX_TYPE n, P XX, P YY, V *LL) {
+    INDEX_TYPE i, j;
+    V *K0 = (V *)c->K[0], *K1 = (V *)c->K[1];
+
+    if ((c->tile_col != NULL) && (n > c->tile_w)) {
+        ALG_B_tiled(c, m, n, XX, YY, LL);
+        return;
+    }
+
+    if (lcs_rows(c, m, n, XX, YY, LL)) return;
+
+    for (j = 0; j <= n; j++) {
+        K1[j] = 0;
+    }
+
+    for (i = 1; i <= m; i++) {
+        for (j = 0; j <= n; j++) {
+            K0[j] = K1[j];
+        }
+        for (j = 1; j <= n; j++) {
+            if (XX[i - 1] == YY[j - 1]) {
+                K1[j] = K0[j - 1] + 1;
+            } else {
+                K1[j] = max(K1[j - 1], K0[j]);
+            }
+        }
+    }
+
+    for (j = 0; j <= n; j++) {
+        LL[j] = K1[j];
+    }
+}
+
+/*
+Single-pass strip split: one forward scan over all m rows, cut into s strips
+at rows b_t = t m / s. Inside strip t (t > 0) every cell also carries the
+column at which its optimal path crossed row b_t; that carry row is kept
+at the strip's end in C + (t - 1) (n + 1). Walking the kept rows back from
+cell (m, n) gives cut[t], the column of the optimal path on row b_t, with
+no backward scan over reversed sequences. s = 2 is the single-pass
+midpoint; larger s needs s - 1 kept rows but splits into all s strips at
+once.
+*/
+template <class T, class V>
+void split_strips(struct lcs_ctx *c, INDEX_TYPE m, INDEX_TYPE n, T *XX, T *YY, INDEX_TYPE s, INDEX_TYPE *cut,
+                  INDEX_TYPE *C) {
+    INDEX_TYPE r, j, t, cu, cv, *D;
+    int u, v;
+    V *R;
+
+    R = (V *)c->L1;
+    D = NULL;
+
+    for (j = 0; j <= n; j++) {
+        R[j] = 0;
+    }
+
+    for (r = 0, t = 0; r < m; r++) {
+        if (r == (t + 1) * m / s) {
+            t++;
+            D = C + (t - 1) * (n + 1);
+            for (j = 0; j <= n; j++) {
+                D[j] = j;
+            }
+        }
+
+        if (t == 0) {
+            for (j = 1, u = 0; j <= n; j++) {
+                v = R[j];
+                if (XX[r] == YY[j - 1])
+                    R[j] = u + 1;
+                else if (R[j - 1] > v)
+                    R[j] = R[j - 1];
+                u = v;
+            }
+        } else {
+            for (j = 1, u = cu = 0; j <= n; j++) {
+                v = R[j];
+                cv = D[j];
+                if (XX[r] == YY[j - 1]) {
+                    R[j] = u + 1;
+                    D[j] = cu;
+                } else if (R[j - 1] > v) {
+                    R[j] = R[j - 1];
+                    D[j] = D[j - 1];
+                }
+                u = v;
+                cu = cv;
+            }
+        }
+    }
+
+    cut[0] = 0;
+    cut[s] = n;
+    for (t = s - 1; t > 0; t--) {
+        cut[t] = C[(t - 1) * (n + 1) + cut[t + 1]];
+    }
+}
+
+/*
+Column of the midpoint split: the first k with the largest A[k] + B[n - k].
+Taking the first maximum fixes which LCS ALG_C reconstructs, so every
+engine that splits this way (interleaved, parallel) returns the same Z.
+*/
+template <class V>
+INDEX_TYPE split_point(INDEX_TYPE n, V *A, V *B) {
+    INDEX_TYPE j, k;
+    int M;
+
+    M = -1;
+    k = 0;
+    for (j = 0; j <= n; j++) {
+        if (A[j] + B[n - j] > M) {
+            k = j;
+            M = A[j] + B[n - j];
+        }
+    }
+
+    return k;
+}
+
+/* Fills CL with the m x n table of XX against YY, row j at j W. */
+template <class T, class V>
+inline void base_fill(V *CL, INDEX_TYPE W, INDEX_TYPE m, INDEX_TYPE n, const T *XX, const T *YY) {
+    INDEX_TYPE i, j, k;
+
+    for (i = 0; i <= m; i++) {
+        CL[i] = 0;
+    }
+    for (j = 0; j <= n; j++) {
+        CL[j * W] = 0;
+    }
+
+    for (j = 1; j <= n; j++) {
+        for (i = 1, k = j * W + 1; i <= m; i++, k++) {
+            if (XX[i - 1] == YY[j - 1]) {
+                CL[k] = CL[k - W - 1] + 1;
+            } else {
+                CL[k] = max(CL[k - W], CL[k - 1]);
+            }
+        }
+    }
+}
+
+/*
+Base case of ALG_C: the full table, then the traceback into Z. N > 0 is
+the kernel for BASE_N = N, with the stride N + 1 a constant and the N x N
+tiles (all but the edges) filled with constant bounds; N = 0 is generic.
+*/
+template <int N, class T, class V>
+void ALG_C_base(struct lcs_ctx *c, INDEX_TYPE m, INDEX_TYPE n, T *XX, T *YY) {
+    const INDEX_TYPE W = (N > 0) ? N + 1 : c->base + 1;
+    INDEX_TYPE i, j, k;
+    int na;
+    T s, *ZZ = (T *)c->Z;
+    V *CL = (V *)c->clen;
+
+    if ((N > 0) && (m == N) && (n == N))
+        base_fill<T, V>(CL, W, N, N, XX, YY);
+    else
+        base_fill<T, V>(CL, W, m, n, XX, YY);
+
+    i = m;
+    j = n;
+    k = c->zp;
+    na = 0;
+
+    while ((i > 0) && (j > 0)) {
+        if (XX[i - 1] == YY[j - 1]) {
+            ZZ[++c->zp] = XX[i - 1];
+            if (c->match != NULL) {
+                c->apos[na++] = XX - (T *)c->X + i;
+                c->apos[na++] = YY - (T *)c->Y + j;
+            }
+            i--;
+            j--;
+        } else if (CL[(j - 1) * W + i] > CL[j * W + i - 1]) {
+            j--;
+        } else {
+            i--;
+        }
+    }
+
+    for (i = k + 1, j = c->zp; i < j; i++, j--) {
+        s = ZZ[i];
+        ZZ[i] = ZZ[j];
+        ZZ[j] = s;
+    }
+
+    for (na -= 2; na >= 0; na -= 2) lcs_emit(c, c->apos[na], c->apos[na + 1]);
+}
+
+/*
+Entries of the k-way cut stack for ALG_C on up to m rows. A k-way level
+of mm rows takes ns + 1 entries, ns <= mm, until its strips return, and
+its strips have at most ceil(mm / 3) rows, so any chain of nested levels
+needs under 1.5 m plus two entries per level (at most 64 levels).
+*/
+INDEX_TYPE kw_cut_words(INDEX_TYPE m) { return 2 * m + 128; }
+
+template <class T, class V, class R>
+void ALG_C_fit(struct lcs_ctx *c, INDEX_TYPE m, INDEX_TYPE n, T *XX, T *YY, R XXR, R YYR);
+
+template <class T, class V, class R>
+void ALG_C(struct lcs_ctx *c, INDEX_TYPE m, INDEX_TYPE n, T *XX, T *YY, R XXR, R YYR) {
+    INDEX_TYPE i, j, k, ns, *cut;
+    T *ZZ = (T *)c->Z;
+    V *LA = (V *)c->L1, *LB = (V *)c->L2;
+
+    if ((m == 0) || (n == 0)) return;
+
+    if (c->cells != NULL) c->cells[sizeof(V) == sizeof(uint16_t)] += m * n;
+
+    if ((n <= c->base) && (m <= c->base)) {
+        static void (*const base[BASE_KERNELS])(struct lcs_ctx *, INDEX_TYPE, INDEX_TYPE, T *, T *) = {
+            ALG_C_base<0, T, V>, ALG_C_base<32, T, V>, ALG_C_base<64, T, V>, ALG_C_base<128, T, V>,
+            ALG_C_base<256, T, V>};
+
+        base[c->base_kernel](c, m, n, XX, YY);
+    }
+    else if (m == 1) {
+        for (j = 1; j <= n; j++) {
+            if (XX[0] == YY[j - 1]) break;
+        }
+        if (j <= n) {
+            ZZ[++c->zp] = XX[0];
+            if (c->match != NULL) lcs_emit(c, XX - (T *)c->X + 1, YY - (T *)c->Y + j);
+        }
+    } else if ((c->split_mode == SPLIT_KWAY) && ((ns = min(m, c->kw_cap / (n + 1) + 1)) > 2)) {
+        // the cuts stay on the stack until every strip has returned
+        cut = (INDEX_TYPE *)c->cuts.p + c->cut_top;
+        c->cut_top += ns + 1;
+        split_strips<T, V>(c, m, n, XX, YY, ns, cut, c->kw_rows);
+
+        for (k = 0; k < ns; k++) {
+            i = k * m / ns;
+            j = (k + 1) * m / ns;
+            ALG_C_fit<T, V>(c, j - i, cut[k + 1] - cut[k], XX + i, YY + cut[k], XXR + m - j, YYR + n - cut[k + 1]);
+        }
+
+        c->cut_top -= ns + 1;
+    } else {
+        i = m >> 1;
+
+        if (c->split_mode != SPLIT_CLASSIC) {
+            INDEX_TYPE mid[3];
+
+            split_strips<T, V>(c, m, n, XX, YY, 2, mid, c->kw_rows);
+            k = mid[1];
+        } else {
+            ALG_B(c, i, n, XX, YY, LA);
+            ALG_B(c, m - i, n, XXR, YYR, LB);
+
+            k = split_point(n, LA, LB);
+        }
+
+        ALG_C_fit<T, V>(c, i, k, XX, YY, XXR + m - i, YYR + n - k);
+        ALG_C_fit<T, V>(c, m - i, n - k, XX + i, YY + k, XXR, YYR);
+    }
+}
+
+/* ALG_C on V scores, or on uint16_t once the subproblem's LCS fits them. */
+template <class T, class V, class R>
+void ALG_C_fit(struct lcs_ctx *c, INDEX_TYPE m, INDEX_TYPE n, T *XX, T *YY, R XXR, R YYR) {
+    if (c->score_auto && (sizeof(V) > sizeof(uint16_t)) && ((min(m, n)) < SCORE16_LIMIT))
+        ALG_C<T, uint16_t>(c, m, n, XX, YY, XXR, YYR);
+    else
+        ALG_C<T, V>(c, m, n, XX, YY, XXR, YYR);
+}
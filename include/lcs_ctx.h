@@ -0,0 +1,108 @@
+/*
+Kernel state: the pair, the LCS and its matches, and the scratch of the
+ALG_C kernels (include/hirschberg.h) and the rec_LCS kernels
+(include/oblivious.h), gathered in one lcs_ctx that every kernel takes
+first. lcs_hirschberg keeps one per thread and lcs_oblivious one for the
+run; liblcs (src/liblcs.cpp) hands one out per lcs_create, so the library
+and the binaries run the same kernels. Scratch that the kernels grow
+themselves comes from the context's allocator.
+*/
+
+#include <atomic>
+#include <iterator>
+#include <mutex>
+
+#define max(a, b) ((a) > (b)) ? (a) : (b)
+#define min(a, b) ((a) < (b)) ? (a) : (b)
+
+// subproblems (ALG_C) or pairs (rec_LCS) with every score below this score in uint16_t
+#define SCORE16_LIMIT 65536
+
+struct lcs_scratch {
+    void *p;
+    size_t bytes;
+};
+
+struct lcs_ctx {
+    lcs_alloc a;
+    int engine;  // liblcs: LCS_HIRSCHBERG or LCS_OBLIVIOUS
+
+    int base, base_kernel;  // BASE_N and its base_sizes slot
+
+    // the pair from X[0] and Y[0] (matches are 1-based), and the LCS in Z (from Z[1] in ALG_C, reversed from Z[0] in rec_LCS); token IDs are read as T
+    char *X, *Y, *Z;
+    INDEX_TYPE nx, ny;
+    int zp;
+
+    // matches (1-based) go to mpos if it is set, else to match(); neither if match is NULL
+    void (*match)(struct lcs_ctx *c, INDEX_TYPE i, INDEX_TYPE j);
+    INDEX_TYPE *mpos, mp;
+
+    const struct alpha_map *alpha;  // match-mask rows while alpha->kernel > 0
+    struct lcs_scratch masks;
+
+    // ALG_C: two score rows, the DP rows of ALG_B, the base-case table and its matches
+    int *L1, *L2, *K[2], *clen;
+    INDEX_TYPE *apos;
+    int score_auto;
+    std::atomic<long long> *cells;  // cells scored at 32 and 16 bits, unless NULL
+    int split_mode;
+    INDEX_TYPE kw_cap, *kw_rows;
+    struct lcs_scratch cuts;  // the k-way cut stack (kw_cut_words entries), in use up to cut_top
+    INDEX_TYPE cut_top;
+    int tile_w;
+    int *tile_col;
+
+    // rec_LCS: the diagonals -ny .. nx at diag0, the boundary stacks and the base-case table
+    INDEX_TYPE diag0, xp, yp;
+    int *rlen, *buf_up, *buf_left, *buf_up_left, *blen;
+    int score;
+    struct snap_cache *snap;  // boundary snapshots, unless NULL
+    struct pack_stats *pack;
+
+    // liblcs: its alphabet and the buffers it sizes per call
+    struct alpha_map codes;
+    struct lcs_scratch seq, rows, tab, bufs;
+};
+
+void *lcs_sys_alloc(size_t bytes, void *user) { return malloc(bytes); }
+
+void lcs_sys_release(void *p, size_t bytes, void *user) { free(p); }
+
+const lcs_alloc lcs_sys = {lcs_sys_alloc, lcs_sys_release, NULL};
+
+/* Makes s hold at least bytes (the contents are not kept); 0 if out of memory. */
+int lcs_reserve(struct lcs_ctx *c, struct lcs_scratch *s, size_t bytes) {
+    if (s->bytes >= bytes) return 1;
+
+    if (s->p != NULL) c->a.release(s->p, s->bytes, c->a.user);
+    s->bytes = 0;
+    if ((s->p = c->a.alloc(bytes, c->a.user)) == NULL) return 0;
+    s->bytes = bytes;
+
+    return 1;
+}
+
+void lcs_unreserve(struct lcs_ctx *c, struct lcs_scratch *s) {
+    if (s->p != NULL) c->a.release(s->p, s->bytes, c->a.user);
+    s->p = NULL;
+    s->bytes = 0;
+}
+
+inline void lcs_emit(struct lcs_ctx *c, INDEX_TYPE i, INDEX_TYPE j) {
+    if (c->mpos != NULL) {
+        c->mpos[c->mp++] = i;
+        c->mpos[c->mp++] = j;
+    } else
+        c->match(c, i, j);
+}
+
+/* alpha_row on the context's alphabet, with the masks in its scratch; 0 if not handled. */
+template <class P, class V>
+int lcs_rows(struct lcs_ctx *c, INDEX_TYPE m, INDEX_TYPE n, P XX, P YY, V *LL) {
+    if ((c->alpha == NULL) || (c->alpha->kernel == 0) || (sizeof(*XX) != 1) ||
+        !lcs_reserve(c, &c->masks, alpha_words(c->alpha, n) * sizeof(uint64_t)))
+        return 0;
+
+    return alpha_row(c->alpha, m, n, XX, YY, LL, (uint64_t *)c->masks.p);
+}
@@ -0,0 +1,103 @@
+/*
+Run-length LCS kernels.
+
+The DP grid of X (M symbols in m runs) against Y (N symbols in n runs)
+splits into m x n blocks, one per pair of runs. Along any DP row or column
+the LCS values grow by 0 or 1 per step, so inside a block the bottom row and
+right column follow from its top row T and left column C in O(1) per entry:
+
+  different symbols:  B[j] = max(T[j], C[p])
+                      R[i] = max(T[q], C[i])
+  same symbol:        B[j] = max(T[max(0, j - p)], C[max(0, p - j)]) + min(j, p)
+                      R[i] = max(C[max(0, i - q)], T[max(0, q - i)]) + min(i, q)
+
+for a p x q block. A pass over one run of X then costs O(N + p n), and a
+full ALG_B_rle pass O(m N + M n) instead of O(M N).
+*/
+
+#define RLE_OFF 0
+#define RLE_ON 1
+#define RLE_AUTO 2
+
+// the run-length pass must be this many times cheaper than the plain one
+#define RLE_FACTOR 4
+
+const char *rle_names[] = {"off", "on", "auto"};
+
+// left / right column of the current block, one entry per row of the run plus the corner
+int *rle_col[2];
+
+static inline int rle_max(int a, int b) { return (a > b) ? a : b; }
+static inline INDEX_TYPE rle_min(INDEX_TYPE a, INDEX_TYPE b) { return (a < b) ? a : b; }
+
+int rle_alloc(INDEX_TYPE m) {
+    rle_col[0] = (int *)malloc((m + 2) * sizeof(int));
+    rle_col[1] = (int *)malloc((m + 2) * sizeof(int));
+
+    return (rle_col[0] != NULL) && (rle_col[1] != NULL);
+}
+
+void rle_free(void) {
+    if (rle_col[0] != NULL) free(rle_col[0]);
+    if (rle_col[1] != NULL) free(rle_col[1]);
+    rle_col[0] = rle_col[1] = NULL;
+}
+
+INDEX_TYPE rle_runs(const char *S, INDEX_TYPE n) {
+    INDEX_TYPE i, r;
+
+    for (i = r = 0; i < n; i++)
+        if ((i == 0) || (S[i] != S[i - 1])) r++;
+
+    return r;
+}
+
+/* Whether the run-length pass pays off for M x N symbols in m x n runs. */
+int rle_pays(long long M, long long N, long long m, long long n) {
+    return (m * N + M * n) * RLE_FACTOR <= M * N;
+}
+
+/* Last row of the LCS table of XX[0..m) against YY[0..n) into LL[0..n], by runs. */
+template <class V>
+void ALG_B_rle(INDEX_TYPE m, INDEX_TYPE n, const char *XX, const char *YY, V *LL) {
+    INDEX_TYPE i, j, p, q, t;
+    int u, v, *C, *R, *S;
+
+    for (j = 0; j <= n; j++) LL[j] = 0;
+
+    C = rle_col[0];
+    R = rle_col[1];
+
+    for (i = 0; i < m; i += p) {
+        for (p = 1; (i + p < m) && (XX[i + p] == XX[i]); p++)
+            ;
+
+        for (t = 0; t <= p; t++) C[t] = 0;
+
+        // LL[j + 1 .. j + q] still hold the block's top row; its corner, already overwritten, is C[0]
+        for (j = 0; j < n; j += q) {
+            for (q = 1; (j + q < n) && (YY[j + q] == YY[j]); q++)
+                ;
+
+            if (XX[i] == YY[j]) {
+                for (t = 0; t <= p; t++) {
+                    u = (t > q) ? C[t - q] : C[0];
+                    v = (t < q) ? LL[j + q - t] : C[0];
+                    R[t] = rle_max(u, v) + (int)rle_min(t, q);
+                }
+                for (t = q; t > 0; t--) {
+                    u = (t > p) ? LL[j + t - p] : C[0];
+                    v = (t < p) ? C[p - t] : C[0];
+                    LL[j + t] = rle_max(u, v) + (int)rle_min(t, p);
+                }
+            } else {
+                for (t = 0; t <= p; t++) R[t] = rle_max(LL[j + q], C[t]);
+                for (t = q; t > 0; t--) LL[j + t] = rle_max(LL[j + t], C[p]);
+            }
+
+            S = C;
+            C = R;
+            R = S;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/*
+liblcs: reentrant LCS engines for embedding (make liblcs: bin/liblcs.a,
+bin/liblcs.so).
+
+All state lives in an lcs_ctx, the kernel context lcs_hirschberg and
+lcs_oblivious run on too (include/lcs_ctx.h), so each engine returns the
+LCS and matches of its binary. A context may be reused for any number of
+calls, and keeps its scratch between calls; contexts share nothing, so
+threads may run concurrently as long as each uses its own context. The
+kernels read the sequences in place from the caller's buffers (no copies,
+no terminator needed), and the LCS and its matches go to caller buffers.
+Scratch is taken from the configured allocator, or malloc / free.
+
+    lcs_config cfg = {LCS_HIRSCHBERG, 0, NULL};
+    lcs_ctx *c = lcs_create(&cfg);
+    long long l = lcs_align(c, x, m, y, n, z, pairs);
+    lcs_destroy(c);
+
+Lengths and positions are 64-bit; scores are int, so min(m, n) must stay
+below 2^31. Negative returns are LCS_ENOMEM or LCS_EINVAL.
+*/
+
+#ifndef LIBLCS_H
+#define LIBLCS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ALG_B / ALG_C, or the cache-oblivious sweep / rec_LCS
+#define LCS_HIRSCHBERG 0
+#define LCS_OBLIVIOUS 1
+
+#define LCS_ENOMEM -1
+#define LCS_EINVAL -2
+
+// liblcs.o is built with hidden symbols, so these four are all it exports
+#define LCS_API __attribute__((visibility("default")))
+
+typedef struct lcs_alloc {
+    void *(*alloc)(size_t bytes, void *user);
+    void (*release)(void *p, size_t bytes, void *user);
+    void *user;
+} lcs_alloc;
+
+typedef struct lcs_config {
+    int engine;  // LCS_HIRSCHBERG or LCS_OBLIVIOUS
+    int base;  // base case size, 0 for the default
+    const lcs_alloc *alloc;  // copied at lcs_create; NULL for malloc / free
+} lcs_config;
+
+typedef struct lcs_ctx lcs_ctx;
+
+/* A new context (cfg NULL for the defaults); NULL if out of memory or cfg is invalid. */
+LCS_API lcs_ctx *lcs_create(const lcs_config *cfg);
+
+/* Frees the context and its scratch. */
+LCS_API void lcs_destroy(lcs_ctx *c);
+
+/* LCS length of x[0..m) and y[0..n). */
+LCS_API long long lcs_length(lcs_ctx *c, const char *x, long long m, const char *y, long long n);
+
+/*
+LCS of x[0..m) and y[0..n): its symbols into z and its matches as 0-based
+(i, j) pairs into pairs, left to right, unless either is NULL. z needs
+min(m, n) bytes, pairs 2 min(m, n) entries. Returns the LCS length.
+*/
+LCS_API long long lcs_align(lcs_ctx *c, const char *x, long long m, const char *y, long long n, char *z,
+                            long long *pairs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,497 @@
+/*
+The cache-oblivious sweeps and traceback of SODA'06 on an lcs_ctx
+(include/lcs_ctx.h), shared by lcs_oblivious and liblcs. The scores live in
+rlen, indexed by diagonal from diag0 (diagonals -ny .. nx, plus one on each
+side), so every kernel runs in O(m + n) space. rec_LCS appends the LCS to Z
+from Z[zp] right to left and its matches through lcs_emit(), saving block
+boundaries in the buf_* stacks and, if the context has one, in the snapshot
+cache.
+
+Cell recurrences for the triangle framework. With rlen indexed by diagonal,
+a cell reads its diagonal predecessor d (its own slot, before the update)
+and its neighbours u and l (the adjacent diagonals), so any recurrence of
+this shape keeps the same sweep order, I/O bound and linear space.
+  init(k)   value of the boundary cell k steps from the origin
+  cell()    the recurrence itself
+  step()    cell() applied in place to the d slot (the triangle inner loop)
+  diag()    whether value v was reached through the diagonal move
+  better()  traceback preference between the two gap moves
+The LCS and edit policies take the symbol type sym (bytes or token IDs)
+and the score type val (int, or uint16_t while every score fits) as
+parameters.
+*/
+
+#define IDX(b, t) (c->diag0 + b + t)
+
+#define SNAP_MIN_BASES 16
+
+template <class T, class V>
+struct lcs_score {
+    typedef T sym;
+    typedef V val;
+    static inline int init(int k) { return 0; }
+    static inline int cell(int d, int u, int l, T x, T y) {
+        return (x == y) ? d + 1 : ((u > l) ? u : l);
+    }
+    static inline void step(V &v, int u, int l, T x, T y) {
+        if (x == y)
+            v = v + 1;
+        else
+            v = (u > l) ? u : l;
+    }
+    static inline int diag(int v, int d, T x, T y) { return x == y; }
+    static inline int better(int a, int b) { return a > b; }
+};
+
+/* Levenshtein distance: unit-cost insertions, deletions and substitutions. */
+template <class T, class V>
+struct edit_score {
+    typedef T sym;
+    typedef V val;
+    static inline int init(int k) { return k; }
+    static inline int cell(int d, int u, int l, T x, T y) {
+        int g = ((u < l) ? u : l) + 1;
+        d += (x != y);
+        return (d < g) ? d : g;
+    }
+    static inline void step(V &v, int u, int l, T x, T y) { v = cell(v, u, l, x, y); }
+    static inline int diag(int v, int d, T x, T y) { return v == d + (x != y); }
+    static inline int better(int a, int b) { return a < b; }
+};
+
+/*
+Boundary snapshot cache: rlen segments left by square sweeps, keyed by the
+square, so that a later rec_LCS on a square reuses the sweeps of its
+quadrants done when the parent swept it whole. Each entry is used once.
+*/
+struct snap {
+    INDEX_TYPE bi, bj, h, w, words;
+    int *v;
+};
+
+struct snap_cache {
+    struct snap *tab;
+    int size, fill;
+    INDEX_TYPE min;
+    long long budget, used;
+    long long hits, lookups;
+    double saved;
+    std::mutex lock;
+};
+
+/*
+Rectangular blocks. The boundary of any h x w block at (bi, bj) lies on its
+h + w + 1 diagonals b - w .. b + h (b = bi - bj): the top row and left
+column on entry, the bottom row and right column after a sweep. So blocks
+need not be square or a power of two. A block is cut into quadrants, or,
+once one side is more than twice the other (or already down to the base
+size), into halves of its longer side only; the first half is the smaller
+one.
+*/
+#define CUT_ROWS 1
+#define CUT_COLS 2
+#define CUT_BOTH 3
+
+int rect_cut(struct lcs_ctx *c, INDEX_TYPE h, INDEX_TYPE w) {
+    if ((h > 2 * w) || (w <= c->base)) return CUT_ROWS;
+    if ((w > 2 * h) || (h <= c->base)) return CUT_COLS;
+    return CUT_BOTH;
+}
+
+/*
+Working set of a sweep over an h x w block: its h + w + 1 diagonals of rlen
+and the h + w symbols of X and Y. Base cases update rlen in place, so the
+base size adds nothing; the scheduler runs two such sweeps on cores sharing
+a cache only if both fit in it.
+*/
+template <class S>
+long long sweep_ws(INDEX_TYPE h, INDEX_TYPE w) {
+    return (h + w + 1LL) * sizeof(typename S::val) + (h + w + 0LL) * sizeof(typename S::sym);
+}
+
+/*
+Sweeps the block: anti-diagonal by anti-diagonal in a base case (no two
+cells of one anti-diagonal depend on each other), else over its parts in
+order. The top-right and bottom-left quadrants touch disjoint diagonals
+and only read the one between them, so they run in parallel under
+sb_fork(); every cell gets the same value in any order, and Z does not
+depend on the thread count.
+*/
+template <class S>
+void lcs_rect(struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE h, INDEX_TYPE w) {
+    typename S::val *R = (typename S::val *)c->rlen;
+    INDEX_TYPE i, l, d, e, h1, w1, b = bi - bj;
+    const typename S::sym *x = (const typename S::sym *)c->X + bi - 1, *y = (const typename S::sym *)c->Y + bj - 1;
+    int cut;
+
+    if ((h <= c->base) && (w <= c->base)) {
+        for (d = 0; d < h + w - 1; d++) {
+            i = max(0, d - w + 1);
+            e = min(h - 1, d);
+            for (l = IDX(b, 2 * i - d); i <= e; i++, l += 2)
+                S::step(R[l], R[l - 1], R[l + 1], x[i], y[d - i]);
+        }
+        return;
+    }
+
+    cut = rect_cut(c, h, w);
+    h1 = (cut & CUT_ROWS) ? h >> 1 : h;
+    w1 = (cut & CUT_COLS) ? w >> 1 : w;
+
+    if (cut == CUT_ROWS) {
+        lcs_rect<S>(c, bi, bj, h1, w);
+        lcs_rect<S>(c, bi + h1, bj, h - h1, w);
+    } else if (cut == CUT_COLS) {
+        lcs_rect<S>(c, bi, bj, h, w1);
+        lcs_rect<S>(c, bi, bj + w1, h, w - w1);
+    } else {
+        lcs_rect<S>(c, bi, bj, h1, w1);
+        sb_fork(c, lcs_rect<S>, bi, bj + w1, h1, w - w1, lcs_rect<S>, bi + h1, bj, h - h1, w1,
+                sweep_ws<S>(h1, w - w1) + sweep_ws<S>(h - h1, w1));
+        lcs_rect<S>(c, bi + h1, bj + w1, h - h1, w - w1);
+    }
+}
+
+unsigned snap_hash(struct snap_cache *s, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE h, INDEX_TYPE w) {
+    return ((unsigned)bi * 2654435761u ^ (unsigned)bj * 40503u ^ (unsigned)h * 97u ^ (unsigned)w) & (s->size - 1);
+}
+
+/* Slot holding block (bi, bj, h, w), or the empty slot ending its probe run. */
+int snap_find(struct snap_cache *s, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE h, INDEX_TYPE w) {
+    int k;
+
+    for (k = snap_hash(s, bi, bj, h, w); s->tab[k].h != 0; k = (k + 1) & (s->size - 1))
+        if ((s->tab[k].h == h) && (s->tab[k].w == w) && (s->tab[k].bi == bi) && (s->tab[k].bj == bj)) break;
+
+    return k;
+}
+
+void snap_clear(struct snap_cache *s) {
+    int k;
+
+    for (k = 0; k < s->size; k++) {
+        if (s->tab[k].v != NULL) free(s->tab[k].v);
+        s->tab[k].v = NULL;
+        s->tab[k].h = 0;
+    }
+
+    s->fill = 0;
+    s->used = 0;
+}
+
+/*
+Smallest h + w of a cached block: the levels of the h x w problem, from its
+parts down, are added while they fit in the budget. Below SNAP_MIN_BASES
+base cases a side, a plain sweep beats splitting the block into cached
+parts.
+*/
+INDEX_TYPE snap_level(struct lcs_ctx *c, INDEX_TYPE h, INDEX_TYPE w) {
+    INDEX_TYPE s = h + w, words;
+    int cut;
+    double need = 0.0, cnt = 1.0;
+
+    while ((h > c->base) || (w > c->base)) {
+        cut = rect_cut(c, h, w);
+        if (cut & CUT_ROWS) h >>= 1;
+        if (cut & CUT_COLS) w >>= 1;
+        if (h + w < 2 * SNAP_MIN_BASES * c->base) break;
+
+        words = pack_on ? pack_words(h + w + 1) : pack_max_words(h + w + 1);
+        need += ((cut == CUT_BOTH) ? 3.0 : 1.0) * cnt * words * sizeof(int);
+        cnt *= (cut == CUT_BOTH) ? 4.0 : 2.0;
+        if (need > c->snap->budget) break;
+        s = h + w;
+    }
+
+    return s;
+}
+
+template <class V>
+void snap_store(struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE h, INDEX_TYPE w) {
+    struct snap_cache *s = c->snap;
+    V *R = (V *)c->rlen;
+    INDEX_TYPE words, b = bi - bj;
+    int k, *v;
+    long long sz;
+
+    std::lock_guard<std::mutex> g(s->lock);
+
+    if ((v = (int *)malloc(pack_max_words(h + w + 1) * sizeof(int))) == NULL) return;
+    words = pack_boundary(R + IDX(b, -w), h + w + 1, v, c->pack);
+    sz = words * sizeof(int);
+
+    if ((s->used + sz > s->budget) || (4 * (s->fill + 1) > 3 * s->size)) {
+        free(v);
+        return;
+    }
+    v = (int *)realloc(v, sz);
+
+    k = snap_find(s, bi, bj, h, w);
+    if (s->tab[k].h == 0) s->fill++;
+    if (s->tab[k].v != NULL) free(s->tab[k].v);
+    s->tab[k].bi = bi;
+    s->tab[k].bj = bj;
+    s->tab[k].h = h;
+    s->tab[k].w = w;
+    s->tab[k].words = words;
+    s->tab[k].v = v;
+    s->used += sz;
+}
+
+/*
+Sweeps block (bi, bj, h, w) over the parts rec_LCS cuts it into, recursively
+while they are large enough to cache, keeping the boundaries of all but the
+last part (rec_LCS on the block recomputes only those) and, if keep, the
+block's own.
+*/
+template <class S>
+void snap_fill_sweep(struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE h, INDEX_TYPE w, int keep);
+
+template <class S>
+void snap_fill_keep(struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE h, INDEX_TYPE w) {
+    snap_fill_sweep<S>(c, bi, bj, h, w, 1);
+}
+
+template <class S>
+void snap_fill_sweep(struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE h, INDEX_TYPE w, int keep) {
+    INDEX_TYPE h1, w1;
+    int cut;
+
+    cut = rect_cut(c, h, w);
+    h1 = (cut & CUT_ROWS) ? h >> 1 : h;
+    w1 = (cut & CUT_COLS) ? w >> 1 : w;
+
+    if (((h <= c->base) && (w <= c->base)) || (h1 + w1 < c->snap->min))
+        lcs_rect<S>(c, bi, bj, h, w);
+    else if (cut == CUT_ROWS) {
+        snap_fill_sweep<S>(c, bi, bj, h1, w, 1);
+        snap_fill_sweep<S>(c, bi + h1, bj, h - h1, w, 0);
+    } else if (cut == CUT_COLS) {
+        snap_fill_sweep<S>(c, bi, bj, h, w1, 1);
+        snap_fill_sweep<S>(c, bi, bj + w1, h, w - w1, 0);
+    } else {
+        snap_fill_sweep<S>(c, bi, bj, h1, w1, 1);
+        sb_fork(c, snap_fill_keep<S>, bi, bj + w1, h1, w - w1, snap_fill_keep<S>, bi + h1, bj, h - h1, w1,
+                sweep_ws<S>(h1, w - w1) + sweep_ws<S>(h - h1, w1));
+        snap_fill_sweep<S>(c, bi + h1, bj + w1, h - h1, w - w1, 0);
+    }
+
+    if (keep && (h + w >= c->snap->min)) snap_store<typename S::val>(c, bi, bj, h, w);
+}
+
+/* Block sweep for rec_LCS: restored from the cache if its parent left it there. */
+template <class S>
+void snap_sweep(struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE h, INDEX_TYPE w) {
+    struct snap_cache *s = c->snap;
+    typename S::val *R = (typename S::val *)c->rlen;
+    INDEX_TYPE b = bi - bj;
+    int k;
+
+    if ((s == NULL) || (h + w < s->min)) {
+        lcs_rect<S>(c, bi, bj, h, w);
+        return;
+    }
+
+    s->lookups++;
+    k = snap_find(s, bi, bj, h, w);
+
+    if (s->tab[k].v != NULL) {
+        unpack_boundary(s->tab[k].v, h + w + 1, R + IDX(b, -w));
+        free(s->tab[k].v);
+        s->tab[k].v = NULL;
+        s->tab[k].bi = s->tab[k].bj = -1;
+        s->used -= s->tab[k].words * sizeof(int);
+        s->hits++;
+        s->saved += (double)h * w;
+    } else
+        snap_fill_sweep<S>(c, bi, bj, h, w, 0);
+}
+
+/* Fills B, row j at j W, from the input boundary in R, for the mm x nn cells from (bi, bj). */
+template <class S>
+inline void rec_fill(struct lcs_ctx *c, typename S::val *B, const typename S::val *R, INDEX_TYPE W, INDEX_TYPE bi,
+                     INDEX_TYPE bj, INDEX_TYPE mm, INDEX_TYPE nn) {
+    INDEX_TYPE i, j, k, b = bi - bj;
+    const typename S::sym *xx = (const typename S::sym *)c->X + bi - 1, *yy = (const typename S::sym *)c->Y + bj - 1;
+
+    for (k = 0; k <= mm; k++) B[k] = R[IDX(b, k)];
+
+    for (k = 0; k <= nn; k++) B[k * W] = R[IDX(b, -k)];
+
+    for (j = 1; j <= nn; j++)
+        for (i = 1, k = j * W + 1; i <= mm; i++, k++)
+            B[k] = S::cell(B[k - W - 1], B[k - W], B[k - 1], xx[i - 1], yy[j - 1]);
+}
+
+/*
+Base case of rec_LCS: the table from (bi, bj) to the path at (xp, yp), then
+the traceback. N > 0 is the kernel for the base size N, with the stride
+N + 1 a constant and the N x N tiles filled with constant bounds; N = 0 is
+generic. Diagonal moves that are not matches (edit and weighted scores)
+are emitted with i negated.
+*/
+template <int N, class S>
+void rec_base(struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj) {
+    const INDEX_TYPE W = (N > 0) ? N + 1 : c->base + 1;
+    typename S::val *R = (typename S::val *)c->rlen, *B = (typename S::val *)c->blen;
+    INDEX_TYPE mm = c->xp - bi + 1, nn = c->yp - bj + 1;
+    const typename S::sym *xx = (const typename S::sym *)c->X + bi - 1, *yy = (const typename S::sym *)c->Y + bj - 1;
+    typename S::sym x, y;
+
+    if ((N > 0) && (mm == N) && (nn == N))
+        rec_fill<S>(c, B, R, W, bi, bj, N, N);
+    else
+        rec_fill<S>(c, B, R, W, bi, bj, mm, nn);
+
+    if ((c->xp == c->nx) && (c->yp == c->ny)) c->score = B[nn * W + mm];
+
+    while ((mm > 0) && (nn > 0)) {
+        x = xx[mm - 1];
+        y = yy[nn - 1];
+        if (S::diag(B[nn * W + mm], B[(nn - 1) * W + mm - 1], x, y)) {
+            if (x == y) {
+                ((typename S::sym *)c->Z)[c->zp++] = x;
+                if (c->match != NULL) lcs_emit(c, bi + mm - 1, bj + nn - 1);
+            } else if (c->match != NULL)
+                lcs_emit(c, -(bi + mm - 1), bj + nn - 1);
+            mm--;
+            nn--;
+        } else if (S::better(B[(nn - 1) * W + mm], B[nn * W + mm - 1]))
+            nn--;
+        else
+            mm--;
+    }
+
+    c->xp = mm + bi - 1;
+    c->yp = nn + bj - 1;
+}
+
+/*
+Traceback over block (bi, bj, h, w), entered with the path at (xp, yp)
+inside it and the block's input boundary in rlen. The parts the path can
+still reach are swept (after saving their input boundaries at f in the
+buf_* stacks), and the parts it does reach are solved last to first. A
+level's saves fit in h2 + w2 + 2 words, h2 x w2 being its last part.
+*/
+template <class S>
+void rec_LCS(struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE h, INDEX_TYPE w, INDEX_TYPE f) {
+    typename S::val *R = (typename S::val *)c->rlen;
+    INDEX_TYPE i, j, h1, w1, h2, w2, b = bi - bj;
+    int cut, sv;
+
+    if ((h <= c->base) && (w <= c->base)) {
+        static void (*const base[BASE_KERNELS])(struct lcs_ctx *, INDEX_TYPE, INDEX_TYPE) = {
+            rec_base<0, S>, rec_base<32, S>, rec_base<64, S>, rec_base<128, S>, rec_base<256, S>};
+
+        base[c->base_kernel](c, bi, bj);
+        return;
+    }
+
+    cut = rect_cut(c, h, w);
+    h1 = (cut & CUT_ROWS) ? h >> 1 : h;
+    w1 = (cut & CUT_COLS) ? w >> 1 : w;
+    h2 = (cut & CUT_ROWS) ? h - h1 : h;
+    w2 = (cut & CUT_COLS) ? w - w1 : w;
+
+    if (cut == CUT_BOTH) {
+        if ((c->xp >= bi + h1) || (c->yp >= bj + w1)) {
+            sv = 1;
+
+            pack_boundary(R + IDX(b, -w1), h1 + w1 + 1, c->buf_up_left + f, c->pack);
+
+            snap_sweep<S>(c, bi, bj, h1, w1);
+        } else
+            sv = 0;
+
+        if ((c->xp >= bi + h1) && (c->yp >= bj + w1)) {
+            pack_boundary(R + IDX(b - w1, -w2), h1 + w2 + 1, c->buf_left + f, c->pack);
+
+            snap_sweep<S>(c, bi, bj + w1, h1, w2);
+
+            pack_boundary(R + IDX(b + h1, -w1), h2 + w1 + 1, c->buf_up + f, c->pack);
+
+            snap_sweep<S>(c, bi + h1, bj, h2, w1);
+
+            rec_LCS<S>(c, bi + h1, bj + w1, h2, w2, f + h2 + w2 + 2);
+
+            if (c->xp >= bi + h1) {
+                unpack_boundary(c->buf_up + f, h2 + w1 + 1, R + IDX(b + h1, -w1));
+            } else if (c->yp >= bj + w1) {
+                unpack_boundary(c->buf_left + f, h1 + w2 + 1, R + IDX(b - w1, -w2));
+            }
+        }
+
+        if (c->xp >= bi + h1)
+            rec_LCS<S>(c, bi + h1, bj, h2, w1, f + h2 + w2 + 2);
+        else if (c->yp >= bj + w1)
+            rec_LCS<S>(c, bi, bj + w1, h1, w2, f + h2 + w2 + 2);
+    } else {
+        // halves: the first is h1 x w1 at (bi, bj), the second h2 x w2 below or right of it
+        i = (cut == CUT_ROWS) ? h1 : 0;
+        j = (cut == CUT_COLS) ? w1 : 0;
+
+        if ((c->xp >= bi + i) && (c->yp >= bj + j)) {
+            sv = 1;
+
+            pack_boundary(R + IDX(b, -w1), h1 + w1 + 1, c->buf_up_left + f, c->pack);
+
+            snap_sweep<S>(c, bi, bj, h1, w1);
+
+            rec_LCS<S>(c, bi + i, bj + j, h2, w2, f + h2 + w2 + 2);
+        } else
+            sv = 0;
+    }
+
+    if ((c->xp >= bi) && (c->yp >= bj)) {
+        if (sv) {
+            unpack_boundary(c->buf_up_left + f, h1 + w1 + 1, R + IDX(b, -w1));
+        }
+
+        rec_LCS<S>(c, bi, bj, h1, w1, f + h2 + w2 + 2);
+    }
+}
+
+/*
+The LCS (or alignment) of the pair in the context: rlen set to the
+boundary, then rec_LCS over the whole nx x ny block. Needs diag0 >= ny + 1
+and nx + ny + 3 entries of rlen from it, 3 (nx + ny) + 256 entries of each
+buf_* stack and the (base + 1)^2 table in blen.
+*/
+template <class S>
+void rec_align(struct lcs_ctx *c) {
+    typename S::val *R = (typename S::val *)c->rlen;
+    INDEX_TYPE j;
+
+    for (j = -c->ny; j <= c->nx; j++) R[IDX(0, j)] = S::init((j < 0) ? -j : j);
+
+    c->xp = c->nx;
+    c->yp = c->ny;
+    c->zp = 0;
+    c->score = R[IDX(0, c->nx - c->ny)];
+
+    if (c->snap != NULL) {
+        snap_clear(c->snap);
+        c->snap->hits = c->snap->lookups = 0;
+        c->snap->saved = 0.0;
+        c->snap->min = snap_level(c, c->nx, c->ny);
+    }
+
+    if ((c->nx > 0) && (c->ny > 0)) rec_LCS<S>(c, 1, 1, c->nx, c->ny, 0);
+}
+
+/*
+Length only: a single cache-oblivious sweep over the whole nx x ny block,
+without the boundary snapshots and recomputation that rec_LCS needs to
+build Z.
+*/
+template <class S>
+int rec_length(struct lcs_ctx *c) {
+    typename S::val *R = (typename S::val *)c->rlen;
+    INDEX_TYPE j;
+
+    for (j = -c->ny; j <= c->nx; j++) R[IDX(0, j)] = S::init((j < 0) ? -j : j);
+
+    if ((c->nx > 0) && (c->ny > 0)) lcs_rect<S>(c, 1, 1, c->nx, c->ny);
+
+    return R[IDX(0, c->nx - c->ny)];
+}
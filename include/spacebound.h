@@ -0,0 +1,229 @@
+/*
+Space-bounded scheduling of independent sweeps.
+
+The cores in use are ordered so that every cache instance (from
+/sys/devices/system/cpu/cpuN/cache) covers a contiguous range of them. A
+thread runs inside a range of cores and is pinned to it. When a sweep
+forks two independent halves, the range is split between them, on a cache
+boundary if the range spans several caches, but only if both halves fit
+together in the smallest cache the range shares; otherwise they run one
+after the other on the whole range, each free to fork below. Concurrent
+subtrees therefore never hold more than their shared cache, and the
+sweeps keep their single-core I/O bound per cache.
+*/
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <thread>
+
+#define SB_MAX_LEVELS 4
+#define SB_MAX_CPUS 1024
+
+#define SB_SPACE 0
+#define SB_GREEDY 1
+
+// halves of fewer than this many cells are not worth a thread
+#define SB_MIN_CELLS (1 << 21)
+
+const char *sb_names[] = {"space", "greedy"};
+int sb_mode = SB_SPACE;
+
+int sb_ncpu = 1, sb_pin_on;
+int sb_cpu[SB_MAX_CPUS];
+int sb_levels;
+int sb_level[SB_MAX_LEVELS];
+long long sb_size[SB_MAX_LEVELS];
+int *sb_grp[SB_MAX_LEVELS];
+
+thread_local int sb_lo, sb_hi = 1;
+std::atomic<long long> sb_forks, sb_serial;
+
+struct lcs_ctx;
+
+typedef void (*sb_sweep_fn)(struct lcs_ctx *, INDEX_TYPE, INDEX_TYPE, INDEX_TYPE, INDEX_TYPE);
+
+/* Lowest cpu of the list "a-b,c,..." (the id of the cache instance). */
+int sb_first_cpu(const char *fname) {
+    FILE *fp;
+    int c;
+
+    if ((fp = fopen(fname, "r")) == NULL) return -1;
+    if (fscanf(fp, "%d", &c) != 1) c = -1;
+    fclose(fp);
+
+    return c;
+}
+
+long long sb_read_size(const char *fname) {
+    FILE *fp;
+    long long s;
+    char u = 0;
+
+    if ((fp = fopen(fname, "r")) == NULL) return 0;
+    if (fscanf(fp, "%lld%c", &s, &u) < 1) s = 0;
+    fclose(fp);
+
+    return (u == 'K') ? s << 10 : (u == 'M') ? s << 20 : s;
+}
+
+/* Whether the core at position a sorts before the one at b: by cache instance, largest cache first. */
+int sb_before(int a, int b) {
+    int l;
+
+    for (l = sb_levels - 1; l >= 0; l--)
+        if (sb_grp[l][a] != sb_grp[l][b]) return sb_grp[l][a] < sb_grp[l][b];
+
+    return sb_cpu[a] < sb_cpu[b];
+}
+
+/*
+Reads the data / unified cache levels of the first t allowed cores (all of
+them if t <= 0) and orders the cores. Without /sys the cores form one range
+with no known shared cache, and every fork is taken.
+*/
+int sb_init(int t) {
+    int c, i, j, k, l, n, v, p[SB_MAX_CPUS], q[SB_MAX_CPUS];
+    char fname[128], type[32];
+    cpu_set_t set;
+    FILE *fp;
+
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return 0;
+
+    for (c = n = 0; (c < CPU_SETSIZE) && (n < SB_MAX_CPUS); c++)
+        if (CPU_ISSET(c, &set)) sb_cpu[n++] = c;
+    if (n == 0) return 0;
+
+    sb_levels = 0;
+    for (k = 0; sb_levels < SB_MAX_LEVELS; k++) {
+        sprintf(fname, "/sys/devices/system/cpu/cpu%d/cache/index%d/type", sb_cpu[0], k);
+        if ((fp = fopen(fname, "r")) == NULL) break;
+        v = fscanf(fp, "%31s", type);
+        fclose(fp);
+        if ((v != 1) || (strcmp(type, "Instruction") == 0)) continue;
+
+        l = sb_levels;
+        sprintf(fname, "/sys/devices/system/cpu/cpu%d/cache/index%d/level", sb_cpu[0], k);
+        sb_level[l] = (int)sb_read_size(fname);
+        sprintf(fname, "/sys/devices/system/cpu/cpu%d/cache/index%d/size", sb_cpu[0], k);
+        sb_size[l] = sb_read_size(fname);
+        if ((sb_grp[l] = (int *)malloc(n * sizeof(int))) == NULL) return 0;
+
+        for (i = 0; i < n; i++) {
+            sprintf(fname, "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", sb_cpu[i], k);
+            sb_grp[l][i] = sb_first_cpu(fname);
+        }
+        sb_levels++;
+    }
+
+    // sort positions, then keep the first t cores
+    for (i = 0; i < n; i++) p[i] = i;
+    for (i = 1; i < n; i++)
+        for (j = i; (j > 0) && sb_before(p[j], p[j - 1]); j--) {
+            v = p[j];
+            p[j] = p[j - 1];
+            p[j - 1] = v;
+        }
+
+    sb_ncpu = ((t > 0) && (t < n)) ? t : n;
+
+    for (l = 0; l < sb_levels; l++) {
+        for (i = 0; i < sb_ncpu; i++) q[i] = sb_grp[l][p[i]];
+        memcpy(sb_grp[l], q, sb_ncpu * sizeof(int));
+    }
+    for (i = 0; i < sb_ncpu; i++) q[i] = sb_cpu[p[i]];
+    memcpy(sb_cpu, q, sb_ncpu * sizeof(int));
+
+    sb_pin_on = (sb_ncpu > 1);
+    sb_lo = 0;
+    sb_hi = sb_ncpu;
+
+    return 1;
+}
+
+void sb_free(void) {
+    int l;
+
+    for (l = 0; l < sb_levels; l++)
+        if (sb_grp[l] != NULL) free(sb_grp[l]);
+    sb_levels = 0;
+}
+
+/* Confines the calling thread to cores lo .. hi - 1. */
+void sb_enter(int lo, int hi) {
+    cpu_set_t set;
+    int i;
+
+    sb_lo = lo;
+    sb_hi = hi;
+    if (!sb_pin_on) return;
+
+    CPU_ZERO(&set);
+    for (i = lo; i < hi; i++) CPU_SET(sb_cpu[i], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/* Bytes of the smallest cache shared by cores lo .. hi - 1, 0 if there is none. */
+long long sb_cap(int lo, int hi) {
+    int l;
+
+    for (l = 0; l < sb_levels; l++)
+        if (sb_grp[l][lo] == sb_grp[l][hi - 1]) return sb_size[l];
+
+    return 0;
+}
+
+/* Split point of lo .. hi - 1: the boundary of the largest unshared cache closest to the middle. */
+int sb_split(int lo, int hi) {
+    int l, i, mid = (lo + hi) >> 1, best = -1;
+
+    for (l = sb_levels - 1; l >= 0; l--)
+        if (sb_grp[l][lo] != sb_grp[l][hi - 1]) break;
+    if (l < 0) return mid;
+
+    for (i = lo + 1; i < hi; i++)
+        if ((sb_grp[l][i] != sb_grp[l][i - 1]) && ((best < 0) || (abs(i - mid) < abs(best - mid)))) best = i;
+
+    return best;
+}
+
+void sb_run(int lo, int hi, sb_sweep_fn f, struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE h,
+            INDEX_TYPE w) {
+    sb_enter(lo, hi);
+    f(c, bi, bj, h, w);
+}
+
+/*
+Runs the independent sweeps a(c, ai, aj, ah, aw) and b(c, bi, bj, bh, bw),
+with a working set of ws bytes between them, in parallel if the current
+range of cores can hold both at once.
+*/
+void sb_fork(struct lcs_ctx *c, sb_sweep_fn a, INDEX_TYPE ai, INDEX_TYPE aj, INDEX_TYPE ah, INDEX_TYPE aw,
+             sb_sweep_fn b, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE bh, INDEX_TYPE bw, long long ws) {
+    int lo = sb_lo, hi = sb_hi, mid;
+    long long cap;
+
+    if ((hi - lo < 2) || (ah * aw < SB_MIN_CELLS) || (bh * bw < SB_MIN_CELLS)) {
+        a(c, ai, aj, ah, aw);
+        b(c, bi, bj, bh, bw);
+        return;
+    }
+
+    cap = sb_cap(lo, hi);
+    if ((sb_mode == SB_SPACE) && (cap > 0) && (ws > cap)) {
+        sb_serial++;
+        a(c, ai, aj, ah, aw);
+        b(c, bi, bj, bh, bw);
+        return;
+    }
+
+    sb_forks++;
+    mid = sb_split(lo, hi);
+
+    std::thread t(sb_run, lo, mid, a, c, ai, aj, ah, aw);
+    sb_enter(mid, hi);
+    b(c, bi, bj, bh, bw);
+    t.join();
+    sb_enter(lo, hi);
+}
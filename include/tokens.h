@@ -0,0 +1,154 @@
+/*
+Token front-end: two text files are split into lines or whitespace-separated
+words, each token is hashed (64-bit FNV-1a) and numbered 1, 2, ... in order
+of first appearance over both files, so equal tokens get equal IDs. The
+engines then run on the ID sequences, with symbols of tok_width() bytes:
+1 for under 256 distinct tokens, 2 for under 65536, else 4.
+*/
+
+#include <ctype.h>
+
+#define TOK_OFF 0
+#define TOK_LINES 1
+#define TOK_WORDS 2
+
+#define TOK_HASH_BASIS 0xcbf29ce484222325ULL
+#define TOK_HASH_PRIME 0x100000001b3ULL
+
+const char *tok_names[] = {"off", "lines", "words"};
+int tok_mode;
+
+unsigned *tok_x, *tok_y;
+INDEX_TYPE tok_nx, tok_ny;
+unsigned tok_distinct;
+
+// open addressing from token hash to ID; tok_key 0 marks an empty slot
+unsigned long long *tok_key;
+unsigned *tok_val;
+INDEX_TYPE tok_size;
+
+void tok_free(void) {
+    if (tok_x != NULL) free(tok_x);
+    if (tok_y != NULL) free(tok_y);
+    if (tok_key != NULL) free(tok_key);
+    if (tok_val != NULL) free(tok_val);
+    tok_x = tok_y = NULL;
+    tok_key = NULL;
+    tok_val = NULL;
+}
+
+INDEX_TYPE tok_slot(unsigned long long h) {
+    INDEX_TYPE k;
+
+    for (k = (INDEX_TYPE)((h * 0x9E3779B97F4A7C15ULL) >> 20) & (tok_size - 1); (tok_key[k] != 0) && (tok_key[k] != h);
+         k = (k + 1) & (tok_size - 1))
+        ;
+
+    return k;
+}
+
+/* Doubles the table; returns 0 if out of memory. */
+int tok_grow(void) {
+    unsigned long long *key = tok_key;
+    unsigned *val = tok_val;
+    INDEX_TYPE i, k, size = tok_size;
+
+    tok_size = (size > 0) ? 2 * size : 1024;
+    tok_key = (unsigned long long *)calloc(tok_size, sizeof(unsigned long long));
+    tok_val = (unsigned *)malloc(tok_size * sizeof(unsigned));
+    if ((tok_key == NULL) || (tok_val == NULL)) return 0;
+
+    for (i = 0; i < size; i++) {
+        if (key[i] == 0) continue;
+        k = tok_slot(key[i]);
+        tok_key[k] = key[i];
+        tok_val[k] = val[i];
+    }
+
+    if (key != NULL) free(key);
+    if (val != NULL) free(val);
+
+    return 1;
+}
+
+unsigned tok_id(const char *s, INDEX_TYPE len) {
+    unsigned long long h = TOK_HASH_BASIS;
+    INDEX_TYPE i, k;
+
+    for (i = 0; i < len; i++) h = (h ^ (unsigned char)s[i]) * TOK_HASH_PRIME;
+    if (h == 0) h = 1;
+
+    if ((4 * ((INDEX_TYPE)tok_distinct + 1) > 3 * tok_size) && !tok_grow()) return 0;
+
+    k = tok_slot(h);
+    if (tok_key[k] == 0) {
+        tok_key[k] = h;
+        tok_val[k] = ++tok_distinct;
+    }
+
+    return tok_val[k];
+}
+
+/* Reads fname into *ids, one ID per token; returns the token count, -1 on failure. */
+INDEX_TYPE tok_file(const char *fname, unsigned **ids) {
+    FILE *fp;
+    char *buf;
+    INDEX_TYPE len, i, j, e, n;
+
+    if ((fp = fopen(fname, "rb")) == NULL) return -1;
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    rewind(fp);
+
+    buf = (char *)malloc(len + 1);
+    *ids = (unsigned *)malloc((len / ((tok_mode == TOK_WORDS) ? 2 : 1) + 2) * sizeof(unsigned));
+    if ((buf == NULL) || (*ids == NULL) || (fread(buf, 1, len, fp) != (size_t)len)) {
+        fclose(fp);
+        if (buf != NULL) free(buf);
+        return -1;
+    }
+    fclose(fp);
+
+    for (i = n = 0; i < len; i = j + 1) {
+        if (tok_mode == TOK_LINES) {
+            for (j = i; (j < len) && (buf[j] != '\n'); j++)
+                ;
+            e = ((j > i) && (buf[j - 1] == '\r')) ? j - 1 : j;
+        } else {
+            for (; (i < len) && isspace((unsigned char)buf[i]); i++)
+                ;
+            if (i == len) break;
+            for (j = i; (j < len) && !isspace((unsigned char)buf[j]); j++)
+                ;
+            e = j;
+        }
+        if (((*ids)[n++] = tok_id(buf + i, e - i)) == 0) {
+            free(buf);
+            return -1;
+        }
+    }
+
+    free(buf);
+
+    return n;
+}
+
+int tok_read(const char *fname1, const char *fname2) {
+    tok_distinct = 0;
+    if ((tok_nx = tok_file(fname1, &tok_x)) < 0) return 0;
+    if ((tok_ny = tok_file(fname2, &tok_y)) < 0) return 0;
+
+    return 1;
+}
+
+int tok_width(void) { return (tok_distinct < 256) ? 1 : (tok_distinct < 65536) ? 2 : 4; }
+
+/* Writes ids[0..n) as symbols of type T into S[1..n], 0-terminated. */
+template <class T>
+void tok_store(char *S, const unsigned *ids, INDEX_TYPE n) {
+    T *s = (T *)S;
+    INDEX_TYPE i;
+
+    for (i = 0; i < n; i++) s[i + 1] = (T)ids[i];
+    s[n + 1] = 0;
+}
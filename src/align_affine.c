@@ -0,0 +1,574 @@
+/*
+Affine-gap alignment in linear space: Gotoh's three-state recurrences run
+inside Hirschberg's divide and conquer, following Myers and Miller,
+"Optimal alignments in linear space" (CABIOS, 1988).
+
+A gap of length k costs gap_open + k * gap_extend. ALG_B_affine runs the
+forward (or, on reversed strings, the backward) scan over three states:
+CC (best cost, any last column) and DD (best cost ending in a deletion).
+ALG_C_affine joins the two scans at the middle row, either through a
+single cell or through a deletion gap crossing that row, so its opening
+cost is paid once; tb and te carry the opening cost of a deletion gap at
+either end of a sub-problem across the split.
+
+Global mode is Needleman-Wunsch. Local mode (Smith-Waterman) finds the end
+of the best local alignment with a forward scan, its start with a scan
+backwards from that end, and then aligns the two substrings globally.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "../include/util.h"
+#include "../include/align.h"
+
+#define MAX_ALPHABET_SIZE 256
+
+#define SYMBOL_TYPE char
+
+#define max(a, b) ((a) > (b)) ? (a) : (b)
+#define min(a, b) ((a) < (b)) ? (a) : (b)
+
+#define DEFAULT_MATCH 2
+#define DEFAULT_MISMATCH 3
+#define DEFAULT_GAP_OPEN 5
+#define DEFAULT_GAP_EXTEND 2
+
+#define WCOST(a, b) (((a) == (b)) ? -match_score : mismatch_cost)
+#define GAP(k) (((k) <= 0) ? 0 : gap_open + gap_extend * (k))
+
+SYMBOL_TYPE *X;
+SYMBOL_TYPE *Y;
+
+int nx, ny;
+
+SYMBOL_TYPE *XR;
+SYMBOL_TYPE *YR;
+
+char **XS;
+char **YS;
+
+int *nxs;
+int *nys;
+
+int *CC;
+int *DD;
+int *RR;
+int *SS;
+
+int match_score = DEFAULT_MATCH;
+int mismatch_cost = DEFAULT_MISMATCH;
+int gap_open = DEFAULT_GAP_OPEN;
+int gap_extend = DEFAULT_GAP_EXTEND;
+
+int local;
+int lx, ly, ux, uy;
+int n_match, n_mismatch;
+
+struct rusage *ru;
+int *zps;
+
+char alpha[MAX_ALPHABET_SIZE + 1];
+
+char *fname1;
+char *fname2;
+
+void free_memory(int r) {
+    int i;
+
+    if (XR != NULL) free(XR);
+    if (YR != NULL) free(YR);
+
+    if (CC != NULL) free(CC);
+    if (DD != NULL) free(DD);
+    if (RR != NULL) free(RR);
+    if (SS != NULL) free(SS);
+
+    if (XS != NULL) {
+        for (i = 0; i < r; i++)
+            if (XS[i] != NULL) free(XS[i]);
+
+        free(XS);
+    }
+
+    if (YS != NULL) {
+        for (i = 0; i < r; i++)
+            if (YS[i] != NULL) free(YS[i]);
+
+        free(YS);
+    }
+
+    if (nxs != NULL) free(nxs);
+    if (nys != NULL) free(nys);
+
+    if (ru != NULL) free(ru);
+
+    if (zps != NULL) free(zps);
+}
+
+int allocate_memory(int m, int n, int r) {
+    int i;
+
+    XR = (SYMBOL_TYPE *)malloc((m + 2) * sizeof(SYMBOL_TYPE));
+    YR = (SYMBOL_TYPE *)malloc((n + 2) * sizeof(SYMBOL_TYPE));
+
+    CC = (int *)malloc((n + 2) * sizeof(int));
+    DD = (int *)malloc((n + 2) * sizeof(int));
+    RR = (int *)malloc((n + 2) * sizeof(int));
+    SS = (int *)malloc((n + 2) * sizeof(int));
+
+    XS = (char **)malloc((r) * sizeof(char *));
+    YS = (char **)malloc((r) * sizeof(char *));
+
+    nxs = (int *)malloc((r) * sizeof(int));
+    nys = (int *)malloc((r) * sizeof(int));
+
+    ru = (struct rusage *)malloc((r + 1) * sizeof(struct rusage));
+    zps = (int *)malloc((r) * sizeof(int));
+
+    if ((XR == NULL) || (YR == NULL) || (CC == NULL) || (DD == NULL) || (RR == NULL) ||
+        (SS == NULL) || (XS == NULL) || (YS == NULL) || (nxs == NULL) || (nys == NULL) ||
+        (ru == NULL) || (zps == NULL)) {
+        printf("\nError: memory allocation failed!\n\n");
+        free_memory(r);
+        return 0;
+    }
+
+    for (i = 0; i < r; i++) {
+        XS[i] = (char *)malloc((m + 2) * sizeof(char));
+        YS[i] = (char *)malloc((n + 2) * sizeof(char));
+
+        if ((XS[i] == NULL) || (YS[i] == NULL)) {
+            printf("\nError: memory allocation failed!\n\n");
+            free_memory(r);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int read_data(int r) {
+    int i, d;
+
+    scanf("alphabet: %s\n\n", alpha);
+
+    for (i = 0; i < r; i++) {
+        if (scanf("sequence pair %d:\n\n", &d) != 1) return 0;
+        if (scanf("X = %s\n", XS[i] + 1) != 1) return 0;
+        nxs[i] = strlen(XS[i] + 1);
+        if (scanf("Y = %s\n\n", YS[i] + 1) != 1) return 0;
+        nys[i] = strlen(YS[i] + 1);
+    }
+
+    return 1;
+}
+
+int read_data_sep(int r) {
+    int i;
+    FILE *fp;
+
+    if ((fp = fopen(fname1, "r")) == NULL) return 0;
+    fscanf(fp, "%d\n", &i);
+    for (i = 0; i < r; i++) {
+        if (fscanf(fp, "%s\n", XS[i] + 1) != 1) return 0;
+        nxs[i] = strlen(XS[i] + 1);
+    }
+    fclose(fp);
+
+    if ((fp = fopen(fname2, "r")) == NULL) return 0;
+    fscanf(fp, "%d\n", &i);
+    for (i = 0; i < r; i++) {
+        if (fscanf(fp, "%s\n", YS[i] + 1) != 1) return 0;
+        nys[i] = strlen(YS[i] + 1);
+    }
+    fclose(fp);
+
+    return 1;
+}
+
+int get_m_n_sep(int *m, int *n) {
+    FILE *fp;
+
+    if ((fp = fopen(fname1, "r")) == NULL) return 0;
+    if (fscanf(fp, "%d", m) != 1) return 0;
+    fclose(fp);
+
+    if ((fp = fopen(fname2, "r")) == NULL) return 0;
+    if (fscanf(fp, "%d", n) != 1) return 0;
+    fclose(fp);
+
+    return 1;
+}
+
+void copy_seq(int j) {
+    nx = nxs[j];
+    ny = nys[j];
+
+    X = XS[j];
+    Y = YS[j];
+}
+
+/* Aligned pair XX[0], YY[j - 1] in absolute 1-based coordinates, emitted left to right. */
+void emit_pair(SYMBOL_TYPE *XX, SYMBOL_TYPE *YY, int j) {
+    if (XX[0] == YY[j - 1]) {
+        n_match++;
+        if (align_fp != NULL) align_match(XX - X, YY - Y + j - 1);
+    } else {
+        n_mismatch++;
+        if (align_fp != NULL) align_mismatch(XX - X, YY - Y + j - 1);
+    }
+}
+
+/*
+Rows 0..m of the cost matrix of XX[0..m) against YY[0..n), keeping only the
+last: C[j] is the best cost, D[j] the best cost ending in a deletion. tb is
+the opening cost of a deletion gap that starts at row 0.
+*/
+void ALG_B_affine(int m, int n, SYMBOL_TYPE *XX, SYMBOL_TYPE *YY, int tb, int *C, int *D) {
+    int i, j, c, d, e, s, t;
+
+    C[0] = 0;
+    for (j = 1, t = gap_open; j <= n; j++) {
+        C[j] = t = t + gap_extend;
+        D[j] = t + gap_open;
+    }
+
+    for (i = 1, t = tb; i <= m; i++) {
+        s = C[0];
+        C[0] = c = t = t + gap_extend;
+        e = t + gap_open;
+        for (j = 1; j <= n; j++) {
+            if ((c = c + gap_open + gap_extend) < (e = e + gap_extend)) e = c;
+            if ((c = C[j] + gap_open + gap_extend) < (d = D[j] + gap_extend)) d = c;
+            c = s + WCOST(XX[i - 1], YY[j - 1]);
+            if (e < c) c = e;
+            if (d < c) c = d;
+            s = C[j];
+            C[j] = c;
+            D[j] = d;
+        }
+    }
+
+    D[0] = C[0];
+}
+
+int ALG_C_affine(int m, int n, SYMBOL_TYPE *XX, SYMBOL_TYPE *YY, SYMBOL_TYPE *XXR, SYMBOL_TYPE *YYR,
+                 int tb, int te) {
+    int i, j, k, c, M, type;
+
+    if (n <= 0) return GAP(m);
+    else if (m <= 1) {
+        if (m <= 0) return GAP(n);
+
+        if (tb > te) tb = te;
+        M = (tb + gap_extend) + GAP(n);
+        k = 0;
+        for (j = 1; j <= n; j++) {
+            c = GAP(j - 1) + WCOST(XX[0], YY[j - 1]) + GAP(n - j);
+            if (c < M) {
+                M = c;
+                k = j;
+            }
+        }
+
+        if (k > 0) emit_pair(XX, YY, k);
+
+        return M;
+    }
+
+    i = m >> 1;
+
+    ALG_B_affine(i, n, XX, YY, tb, CC, DD);
+    ALG_B_affine(m - i, n, XXR, YYR, te, RR, SS);
+
+    M = CC[0] + RR[n];
+    k = 0;
+    type = 1;
+    for (j = 0; j <= n; j++) {
+        if ((c = CC[j] + RR[n - j]) < M) {
+            M = c;
+            k = j;
+        }
+    }
+    for (j = n; j >= 0; j--) {
+        if ((c = DD[j] + SS[n - j] - gap_open) < M) {
+            M = c;
+            k = j;
+            type = 2;
+        }
+    }
+
+    if (type == 1) {
+        ALG_C_affine(i, k, XX, YY, XXR + m - i, YYR + n - k, tb, gap_open);
+        ALG_C_affine(m - i, n - k, XX + i, YY + k, XXR, YYR, gap_open, te);
+    } else {
+        ALG_C_affine(i - 1, k, XX, YY, XXR + m - i + 1, YYR + n - k, tb, 0);
+        ALG_C_affine(m - i - 1, n - k, XX + i + 1, YY + k, XXR, YYR, 0, te);
+    }
+
+    return M;
+}
+
+/*
+Local mode, first scan: best Smith-Waterman score and the first cell
+(ux, uy) where it is reached. Scores here are the negated costs.
+*/
+int sw_end(void) {
+    int i, j, h, e, s, best;
+
+    for (j = 0; j <= ny; j++) {
+        CC[j] = 0;
+        DD[j] = -gap_open;
+    }
+
+    best = 0;
+    ux = uy = 0;
+
+    for (i = 1; i <= nx; i++) {
+        s = 0;
+        h = 0;
+        e = -gap_open;
+        for (j = 1; j <= ny; j++) {
+            e = (max(e, h - gap_open)) - gap_extend;
+            DD[j] = (max(DD[j], CC[j] - gap_open)) - gap_extend;
+            h = s - WCOST(X[i], Y[j]);
+            if (e > h) h = e;
+            if (DD[j] > h) h = DD[j];
+            if (h < 0) h = 0;
+            s = CC[j];
+            CC[j] = h;
+            if (h > best) {
+                best = h;
+                ux = i;
+                uy = j;
+            }
+        }
+    }
+
+    return best;
+}
+
+/*
+Local mode, second scan: anchored at (ux, uy) and running backwards over
+X[1..ux], Y[1..uy], the first cell whose score reaches best is the start
+(lx, ly) of an optimal local alignment.
+*/
+void sw_start(int best) {
+    int i, j, h, e, s;
+
+    CC[0] = 0;
+    for (j = 1; j <= uy; j++) {
+        CC[j] = -GAP(j);
+        DD[j] = CC[j] - gap_open;
+    }
+
+    lx = ux;
+    ly = uy;
+
+    for (i = 1; i <= ux; i++) {
+        s = CC[0];
+        CC[0] = h = -GAP(i);
+        e = h - gap_open;
+        for (j = 1; j <= uy; j++) {
+            e = (max(e, h - gap_open)) - gap_extend;
+            DD[j] = (max(DD[j], CC[j] - gap_open)) - gap_extend;
+            h = s - WCOST(X[ux - i + 1], Y[uy - j + 1]);
+            if (e > h) h = e;
+            if (DD[j] > h) h = DD[j];
+            s = CC[j];
+            CC[j] = h;
+            if (h == best) {
+                lx = ux - i + 1;
+                ly = uy - j + 1;
+                return;
+            }
+        }
+    }
+}
+
+int align_affine(void) {
+    int i, m, n, cost;
+    SYMBOL_TYPE *XX, *YY;
+
+    n_match = n_mismatch = 0;
+
+    if (local) {
+        cost = -sw_end();
+        if (cost == 0) {
+            lx = ly = 1;
+            ux = uy = 0;
+            return 0;
+        }
+        sw_start(-cost);
+    } else {
+        lx = ly = 1;
+        ux = nx;
+        uy = ny;
+    }
+
+    m = ux - lx + 1;
+    n = uy - ly + 1;
+    XX = X + lx;
+    YY = Y + ly;
+
+    for (i = 0; i < m; i++) XR[i] = XX[m - 1 - i];
+    for (i = 0; i < n; i++) YR[i] = YY[n - 1 - i];
+
+    if (align_fp != NULL) {
+        align_pi = lx - 1;
+        align_pj = ly - 1;
+    }
+
+    cost = ALG_C_affine(m, n, XX, YY, XR, YR, gap_open, gap_open);
+
+    return -cost;
+}
+
+int main(int argc, char *argv[]) {
+    int i, l, m, n, r, b;
+    double ut, st, tt;
+    char str[50];
+
+    printf(
+        "=====================================================================================\n");
+    printf("Program: %s\n", argv[0]);
+
+    for (i = l = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--match=", 8) == 0)
+            match_score = abs(atoi(argv[i] + 8));
+        else if (strncmp(argv[i], "--mismatch=", 11) == 0)
+            mismatch_cost = abs(atoi(argv[i] + 11));
+        else if (strncmp(argv[i], "--gap-open=", 11) == 0)
+            gap_open = abs(atoi(argv[i] + 11));
+        else if (strncmp(argv[i], "--gap-extend=", 13) == 0)
+            gap_extend = abs(atoi(argv[i] + 13));
+        else if (strcmp(argv[i], "--local") == 0)
+            local = 1;
+        else if (strcmp(argv[i], "--global") == 0)
+            local = 0;
+        else if ((strncmp(argv[i], "--align=", 8) == 0) || (strncmp(argv[i], "--cigar=", 8) == 0)) {
+            if (!align_open(argv[i] + 8, argv[i][2] == 'c')) {
+                printf("\nError: cannot open alignment file %s!\n", argv[i] + 8);
+                return 0;
+            }
+        } else
+            argv[l++] = argv[i];
+    }
+    argc = l;
+
+    if (argc < 3) {
+        printf("\nError: not enough arguments!\n");
+        printf("Specify: n ( = length of sequence ) and r ( = number of runs ).\n\n");
+        printf("Options: --global ( = Needleman-Wunsch, default ) / --local ( = Smith-Waterman ),\n");
+        printf("         --match=a --mismatch=b ( = +a per match, -b per mismatch; default %d, %d ),\n",
+               DEFAULT_MATCH, DEFAULT_MISMATCH);
+        printf("         --gap-open=g --gap-extend=e ( = a gap of length k costs g + e*k; default %d, %d ),\n",
+               DEFAULT_GAP_OPEN, DEFAULT_GAP_EXTEND);
+        printf("         --align=file / --cigar=file ( = stream match pairs / edit script ).\n\n");
+        return 0;
+    }
+
+    n = atoi(argv[1]);
+    if (n == -1) {
+        fname1 = argv[2];
+        fname2 = argv[3];
+        b = 2;
+    } else
+        b = 0;
+
+    r = atoi(argv[b + 2]);
+    m = n;
+
+    if (n == 0) {
+        if (scanf("%d %d\n\n", &m, &n) != 2) {
+            printf("\nError: cannot read sequence lengths!\n");
+            return 0;
+        }
+    } else if (n == -1) {
+        if (!get_m_n_sep(&m, &n)) {
+            printf("\nError: cannot read sequence lengths!\n");
+            return 0;
+        }
+    }
+
+    if (!allocate_memory(m, n, r)) return 0;
+
+    if (b == 0) {
+        if (!read_data(r)) {
+            printf("\nError: failed to read data!\n\n");
+            free_memory(r);
+            return 0;
+        }
+    } else {
+        if (!read_data_sep(r)) {
+            printf("\nError: failed to read data!\n\n");
+            free_memory(r);
+            return 0;
+        }
+    }
+
+    SCORE_NAME = "Alignment score";
+    SCORE_SIGNED = 1;
+
+    printf("m = %d, n = %d\n", m, n);
+    printf("Runs = %d\n", r);
+    printf("Mode: %s\n", local ? "local (Smith-Waterman)" : "global (Needleman-Wunsch)");
+    printf("Scoring: match +%d, mismatch -%d, gap -(%d + %d*k)\n", match_score, mismatch_cost, gap_open,
+           gap_extend);
+
+    getrusage(RUSAGE_SELF, &ru[0]);
+
+    for (i = 0; i < r; i++) {
+        init_disk_io();  // Initialize disk I/O counters
+        init_page_faults();  // Initialize page fault counters
+        double start = get_wall_time();
+        copy_seq(i);
+        if (align_fp != NULL) align_begin(i);
+        zps[i] = align_affine();
+        if (align_fp != NULL) align_end(ux, uy);
+        double end = get_wall_time();
+        getrusage(RUSAGE_SELF, &ru[i + 1]);
+
+        printf("\n");
+        printf("RUN %d RESULTS\n", i + 1);
+        printf("Score: %d\n", zps[i]);
+        if (local) printf("Aligned region: X[%d..%d], Y[%d..%d]\n", lx, ux, ly, uy);
+        printf("Matches: %d, mismatches: %d, gap columns: %d\n", n_match, n_mismatch,
+               (ux - lx + 1) + (uy - ly + 1) - 2 * (n_match + n_mismatch));
+        printf("Time:\n");
+        printf("  Wall time:               %.4f seconds (%s)\n", end - start, conv_sec(end - start, str));
+
+        double run_ut = ru[i + 1].ru_utime.tv_sec + (ru[i + 1].ru_utime.tv_usec * 0.000001) -
+                        (ru[i].ru_utime.tv_sec + (ru[i].ru_utime.tv_usec * 0.000001));
+        double run_st = ru[i + 1].ru_stime.tv_sec + (ru[i + 1].ru_stime.tv_usec * 0.000001) -
+                        (ru[i].ru_stime.tv_sec + (ru[i].ru_stime.tv_usec * 0.000001));
+        double run_tt = run_ut + run_st;
+
+        printf("  User time:               %.4f seconds (%s)\n", run_ut, conv_sec(run_ut, str));
+        printf("  System time:             %.4f seconds (%s)\n", run_st, conv_sec(run_st, str));
+        printf("  Total time:              %.4f seconds (%s)\n", run_tt, conv_sec(run_tt, str));
+
+        print_proc_io();
+        print_disk_io();  // Show disk I/O activity difference
+        print_mem_data();
+    }
+
+    ut = ru[r].ru_utime.tv_sec + (ru[r].ru_utime.tv_usec * 0.000001) -
+         (ru[0].ru_utime.tv_sec + (ru[0].ru_utime.tv_usec * 0.000001));
+    st = ru[r].ru_stime.tv_sec + (ru[r].ru_stime.tv_usec * 0.000001) -
+         (ru[0].ru_stime.tv_sec + (ru[0].ru_stime.tv_usec * 0.000001));
+    tt = ut + st;
+
+    print_final_results(zps[r - 1], ut, st, tt, r, str);
+
+    align_close();
+    free_memory(r);
+
+    return 0;
+}
@@ -36,6 +36,9 @@ int *nys;
 
 int **len;
 
+int threshold;
+int answer;
+
 struct rusage *ru;
 int *zps;
 
@@ -169,18 +172,90 @@ int lcs_classic(int r) {
     return len[n][m];
 }
 
+/*
+Decision mode: fills the table row by row and stops as soon as
+LCS >= threshold is settled, using max(len[j][i] + min(n - j, m - i))
+over the last row as the upper bound, evaluated every DECIDE_ROWS rows.
+*/
+#define DECIDE_ROWS 8
+
+int lcs_classic_decide(int r, double *frac) {
+    int i, j, m, n, v, bound;
+
+    m = nxs[r];
+    n = nys[r];
+
+    X = XS[r];
+    Y = YS[r];
+
+    answer = -1;
+
+    for (i = 0; i <= m; i++) len[0][i] = 0;
+
+    for (j = 0; j <= n; j++) len[j][0] = 0;
+
+    for (j = 0; j <= n; j++) {
+        if (j > 0) {
+            for (i = 1; i <= m; i++) {
+                if (X[i] == Y[j]) {
+                    len[j][i] = len[j - 1][i - 1] + 1;
+                } else {
+                    if (len[j - 1][i] > len[j][i - 1]) {
+                        len[j][i] = len[j - 1][i];
+                    } else {
+                        len[j][i] = len[j][i - 1];
+                    }
+                }
+            }
+        }
+
+        if (len[j][m] >= threshold) {
+            answer = 1;
+        } else if ((j % DECIDE_ROWS) == 0) {
+            bound = 0;
+            for (i = 0; i <= m; i++) {
+                v = len[j][i] + (min(n - j, m - i));
+                if (v > bound) bound = v;
+            }
+            if (bound < threshold) answer = 0;
+        }
+
+        if (answer >= 0) break;
+    }
+
+    if (j >= n) {
+        answer = (len[n][m] >= threshold);
+        *frac = 1.0;
+        return len[n][m];
+    }
+
+    *frac = (n > 0) ? j / (double)n : 0.0;
+
+    return -1;
+}
+
 int main(int argc, char *argv[]) {
     int i, l, m, n, nn, r;
-    double ut, st, tt;
+    double ut, st, tt, frac;
     char str[50];
 
     printf(
         "=====================================================================================\n");
     printf("Program: %s\n", argv[0]);
 
+    for (i = l = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--threshold=", 12) == 0) {
+            threshold = atoi(argv[i] + 12);
+            if (threshold <= 0) threshold = 1;
+        } else
+            argv[l++] = argv[i];
+    }
+    argc = l;
+
     if (argc < 3) {
         printf("\nError: not enough arguments!\n");
         printf("Specify: n ( = length of sequence ) and r ( = number of runs ).\n\n");
+        printf("Options: --threshold=k ( = only decide whether LCS >= k, stopping early ).\n\n");
         return 0;
     }
 
@@ -212,6 +287,7 @@ int main(int argc, char *argv[]) {
 
     printf("m = %d, n = %d\n", m, n);
     printf("Runs = %d\n", r);
+    if (threshold > 0) printf("Mode: decide LCS >= %d\n", threshold);
 
     getrusage(RUSAGE_SELF, &ru[0]);
 
@@ -219,7 +295,10 @@ int main(int argc, char *argv[]) {
         init_disk_io();  // Initialize disk I/O counters
         init_page_faults();  // Initialize page fault counters
         double start = get_wall_time();
-        zps[i] = lcs_classic(i);
+        if (threshold > 0)
+            zps[i] = lcs_classic_decide(i, &frac);
+        else
+            zps[i] = lcs_classic(i);
         double end = get_wall_time();
         getrusage(RUSAGE_SELF, &ru[i + 1]);
 
@@ -238,6 +317,8 @@ int main(int argc, char *argv[]) {
         printf("  System time:             %.4f seconds (%s)\n", run_st, conv_sec(run_st, str));
         printf("  Total time:              %.4f seconds (%s)\n", run_tt, conv_sec(run_tt, str));
 
+        if (threshold > 0) print_decision(threshold, answer, frac);
+
         print_proc_io();
         print_disk_io();  // Show disk I/O activity difference
         print_mem_data();
@@ -3,7 +3,9 @@ Hirschberg's algorithm.
 Last Update: Oct 04, 2005 ( Rezaul Alam Chowdhury, UT Austin )
 */
 
+#include <limits.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,27 +13,44 @@ Last Update: Oct 04, 2005 ( Rezaul Alam Chowdhury, UT Austin )
 #include <sys/time.h>
 #include <time.h>
 
+#include <atomic>
+#include <thread>
+
 #include "../include/util.h"
+#include "../include/align.h"
+#include "../include/lcs_rle.h"
+#include "../include/tokens.h"
+#include "../include/alphabet.h"
+#include "../include/liblcs.h"
+#include "../include/lcs_ctx.h"
+#include "../include/hirschberg.h"
 
 #define DEFAULT_BASE 32
 
-#define MAX_ALPHABET_SIZE 256
+#define DEFAULT_ANCHOR 20
 
-#define SYMBOL_TYPE char
+#define DEFAULT_CHECKPOINTS 64
+
+#define DEFAULT_MEM_BUDGET 64
+
+#define TILE_CELLS (1 << 16)
+#define PREFETCH_LINES 64
+
+#define PAR_MIN_CELLS (1 << 20)
 
-#define max(a, b) ((a) > (b)) ? (a) : (b)
-#define min(a, b) ((a) < (b)) ? (a) : (b)
+#define MAX_ALPHABET_SIZE 256
 
-#define BIDX(j, i) (((j) << LOG_BASE_N) + j + i)
+#define SYMBOL_TYPE char
 
 int BASE_N;
-int LOG_BASE_N;
+int base_kernel;  // base_sizes slot of BASE_N
 
+// with --tokens, X, Y, XR, YR and Z hold sym_bytes-wide token IDs, which the kernels (templates on T) read as T
 SYMBOL_TYPE *X;
 SYMBOL_TYPE *Y;
-SYMBOL_TYPE *Z;
+int sym_bytes = sizeof(SYMBOL_TYPE);
 
-int nx, ny;
+INDEX_TYPE nx, ny;
 
 SYMBOL_TYPE *XR;
 SYMBOL_TYPE *YR;
@@ -39,37 +58,207 @@ SYMBOL_TYPE *YR;
 char **XS;
 char **YS;
 
-int *nxs;
-int *nys;
+INDEX_TYPE *nxs;
+INDEX_TYPE *nys;
+
+/*
+Score width: L1, L2, K, clen and tile_col are allocated with score_bytes
+per entry and read as the kernels' score type V. An LCS never exceeds
+min(m, n), so ALG_C scores any subproblem below SCORE16_LIMIT in uint16_t
+(score_bytes is 2 when the whole pair is), unless --score-width=32.
+score_cells counts the cells scored at 32 and 16 bits.
+*/
+int score_bytes = sizeof(int);
+int score_auto = 1;
+int score_forced;  // --score-width given
+std::atomic<long long> score_cells[2];
 
-int *L1;
-int *L2;
-int **K;
+// per thread, so that independent ALG_C calls can run side by side
+thread_local struct lcs_ctx ctx;
 
-int zp;
+int threshold;
+int answer;
 
-int *clen;
+int samples;
+double min_ratio;
+double *ests;
+
+/*
+Interleaved batches: one resumable ALG_C per pair, with its own buffers and
+an explicit stack of subproblems. A step is one tile of ALG_B rows or one
+base case, after which the pair prefetches its next tile and yields.
+*/
+struct ilv_frame {
+    SYMBOL_TYPE *XX, *YY, *XXR, *YYR;
+    INDEX_TYPE m, n, i, r;
+    int phase;
+};
+
+struct ilv_pair {
+    SYMBOL_TYPE *XR, *YR, *Z;
+    int *L1, *L2, *clen;
+    struct ilv_frame *stk;
+    int top, zp;
+};
+
+int interleave;
+int ilv_depth;
+struct ilv_pair *ilv;
+int ilv_first;
+long long ilv_steps;
+
+char *edits_fname;
+int n_edits, e_ins;
+char *e_op;
+INDEX_TYPE *e_pos;
+SYMBOL_TYPE *e_sym;
+
+// forward / backward checkpoint rows every ck_c symbols of X; the first ck_fv / ck_bv are valid
+INDEX_TYPE ck_c;
+int ck_cap, ck_fv, ck_bv;
+int *ck_f;
+int *ck_b;
+long long ck_rows;
+
+const char *split_names[] = {"classic", "single", "kway"};
+int split_mode = SPLIT_CLASSIC;
+
+// single / k-way split: the carry rows (columns) of up to kw_cap / (n + 1) + 1 strips
+int kw_budget = DEFAULT_MEM_BUDGET;
+INDEX_TYPE kw_cap;
+
+// cache-aware ALG_B: column strips of tile_w, carrying the strip's left column in tile_col
+int cache_kb, tile_w;
+INDEX_TYPE tile_rows;
+
+int rle_mode = RLE_OFF;
+int rle_used;
+INDEX_TYPE rle_x, rle_y;
+
+int anchor_k;
+int anchor_fast;
+int threads;
+
+// set by a --parallel or --anchor worker that could not allocate its buffers; the run then fails
+std::atomic<int> worker_failed;
+
+// deterministic parallel ALG_C: the top par_depth levels score and solve their halves on two threads
+int par_on, par_verify, par_threads, par_depth, par_diff;
+std::atomic<int> par_tasks;
+INDEX_TYPE *ppos;
+SYMBOL_TYPE *zv;
+
+INDEX_TYPE *ahead;
+INDEX_TYPE *anext;
+int *acx;
+int *acy;
+INDEX_TYPE *apy;
+INDEX_TYPE *fi;
+INDEX_TYPE *fj;
+INDEX_TYPE *fl;
+INDEX_TYPE *fbest;
+INDEX_TYPE *fprev;
+INDEX_TYPE *ford;
+INDEX_TYPE *fen;
+INDEX_TYPE *goff;
+INDEX_TYPE *glen;
+SYMBOL_TYPE *zg;
+INDEX_TYPE *gpos;
+INDEX_TYPE atsize;
+int alog;
+
+INDEX_TYPE a_frag, a_chain, a_cover, a_gaps, a_lo, a_hi;
+int a_exact;
+double a_cells, a_check;
+std::atomic<INDEX_TYPE> next_gap;
 
 struct rusage *ru;
 int *zps;
 
 char alpha[MAX_ALPHABET_SIZE + 1];
+struct alpha_map amap;
 
 char *fname1;
 char *fname2;
 
+/* Kernel matches, unless a caller collects them in ctx.mpos: straight to the alignment file. */
+void write_match(struct lcs_ctx *c, INDEX_TYPE i, INDEX_TYPE j) { align_match(i, j); }
+
+/* This thread's kernel context from the options and the current pair; the caller sets its buffers. */
+void ctx_setup(void) {
+    ctx.a = lcs_sys;
+    ctx.base = BASE_N;
+    ctx.base_kernel = base_kernel;
+    ctx.X = X + sym_bytes;
+    ctx.Y = Y + sym_bytes;
+    ctx.match = (align_fp != NULL) ? write_match : NULL;
+    ctx.alpha = &amap;
+    ctx.score_auto = score_auto;
+    ctx.cells = score_cells;
+    ctx.split_mode = split_mode;
+    ctx.kw_cap = kw_cap;
+    ctx.tile_w = tile_w;
+}
+
 void free_memory(int r) {
     int i;
 
-    if (Z != NULL) free(Z);
+    if (ctx.Z != NULL) free(ctx.Z);
 
     if (XR != NULL) free(XR);
     if (YR != NULL) free(YR);
 
-    if (L1 != NULL) free(L1);
-    if (L2 != NULL) free(L2);
-
-    if (clen != NULL) free(clen);
+    if (ctx.L1 != NULL) free(ctx.L1);
+    if (ctx.L2 != NULL) free(ctx.L2);
+
+    if (ctx.clen != NULL) free(ctx.clen);
+    if (ctx.apos != NULL) free(ctx.apos);
+
+    if (ests != NULL) free(ests);
+
+    if (e_op != NULL) free(e_op);
+    if (e_pos != NULL) free(e_pos);
+    if (e_sym != NULL) free(e_sym);
+    if (ctx.kw_rows != NULL) free(ctx.kw_rows);
+    if (ctx.tile_col != NULL) free(ctx.tile_col);
+    lcs_unreserve(&ctx, &ctx.masks);
+    lcs_unreserve(&ctx, &ctx.cuts);
+    if (ck_f != NULL) free(ck_f);
+
+    if (ilv != NULL) {
+        for (i = 0; i < interleave; i++) {
+            if (ilv[i].XR != NULL) free(ilv[i].XR);
+            if (ilv[i].YR != NULL) free(ilv[i].YR);
+            if (ilv[i].Z != NULL) free(ilv[i].Z);
+            if (ilv[i].L1 != NULL) free(ilv[i].L1);
+            if (ilv[i].L2 != NULL) free(ilv[i].L2);
+            if (ilv[i].clen != NULL) free(ilv[i].clen);
+            if (ilv[i].stk != NULL) free(ilv[i].stk);
+        }
+        free(ilv);
+    }
+    if (ck_b != NULL) free(ck_b);
+
+    rle_free();
+
+    if (ahead != NULL) free(ahead);
+    if (anext != NULL) free(anext);
+    if (acx != NULL) free(acx);
+    if (acy != NULL) free(acy);
+    if (apy != NULL) free(apy);
+    if (fi != NULL) free(fi);
+    if (fj != NULL) free(fj);
+    if (fl != NULL) free(fl);
+    if (fbest != NULL) free(fbest);
+    if (fprev != NULL) free(fprev);
+    if (ford != NULL) free(ford);
+    if (fen != NULL) free(fen);
+    if (goff != NULL) free(goff);
+    if (glen != NULL) free(glen);
+    if (zg != NULL) free(zg);
+    if (gpos != NULL) free(gpos);
+    if (ppos != NULL) free(ppos);
+    if (zv != NULL) free(zv);
 
     if (XS != NULL) {
         for (i = 0; i < r; i++)
@@ -88,55 +277,172 @@ void free_memory(int r) {
     if (nxs == NULL) free(nxs);
     if (nys == NULL) free(nys);
 
-    if (K != NULL) {
-        for (i = 0; i < 2; i++)
-            if (K[i] != NULL) free(K[i]);
-
-        free(K);
-    }
+    for (i = 0; i < 2; i++)
+        if (ctx.K[i] != NULL) free(ctx.K[i]);
 
     if (ru != NULL) free(ru);
 
     if (zps != NULL) free(zps);
 }
 
-int allocate_memory(int m, int n, int r, int b) {
-    int i, d, mm;
+int allocate_memory(INDEX_TYPE m, INDEX_TYPE n, int r, int b) {
+    INDEX_TYPE i, mm;
 
     mm = min(m, n);
 
-    Z = (SYMBOL_TYPE *)malloc((mm + 2) * sizeof(SYMBOL_TYPE));
+    ctx.Z = (SYMBOL_TYPE *)malloc((mm + 2) * sym_bytes);
+
+    XR = (SYMBOL_TYPE *)malloc((m + 2) * sym_bytes);
+    YR = (SYMBOL_TYPE *)malloc((n + 2) * sym_bytes);
+
+    ctx.L1 = (int *)malloc((n + 2) * score_bytes);
+    ctx.L2 = (int *)malloc((n + 2) * score_bytes);
+
+    ctx.clen = (int *)malloc((b + 1) * (b + 1) * score_bytes);
+
+    if (samples > 0) ests = (double *)malloc(samples * sizeof(double));
+
+    if (align_fp != NULL) ctx.apos = (INDEX_TYPE *)malloc(2 * (b + 1) * sizeof(INDEX_TYPE));
+
+    if (interleave > 1) {
+        for (ilv_depth = 4, i = m; i > 1; i >>= 1) ilv_depth += 2;
+        ilv = (struct ilv_pair *)calloc(interleave, sizeof(struct ilv_pair));
+        if (ilv == NULL) {
+            printf("\nError: memory allocation failed!\n\n");
+            free_memory(r);
+            return 0;
+        }
+
+        for (i = 0; i < interleave; i++) {
+            ilv[i].XR = (SYMBOL_TYPE *)malloc((m + 2) * sizeof(SYMBOL_TYPE));
+            ilv[i].YR = (SYMBOL_TYPE *)malloc((n + 2) * sizeof(SYMBOL_TYPE));
+            ilv[i].Z = (SYMBOL_TYPE *)malloc((mm + 2) * sizeof(SYMBOL_TYPE));
+            ilv[i].L1 = (int *)malloc((n + 2) * sizeof(int));
+            ilv[i].L2 = (int *)malloc((n + 2) * sizeof(int));
+            ilv[i].clen = (int *)malloc((b + 1) * (b + 1) * sizeof(int));
+            ilv[i].stk = (struct ilv_frame *)malloc(ilv_depth * sizeof(struct ilv_frame));
+
+            if ((ilv[i].XR == NULL) || (ilv[i].YR == NULL) || (ilv[i].Z == NULL) || (ilv[i].L1 == NULL) ||
+                (ilv[i].L2 == NULL) || (ilv[i].clen == NULL) || (ilv[i].stk == NULL)) {
+                printf("\nError: memory allocation failed!\n\n");
+                free_memory(r);
+                return 0;
+            }
+        }
+    }
+
+    if (split_mode != SPLIT_CLASSIC) {
+        if (split_mode == SPLIT_KWAY)
+            kw_cap = min((INDEX_TYPE)kw_budget * 1024 * 1024 / (INDEX_TYPE)sizeof(INDEX_TYPE), (m + 1) * (n + 1));
+        else
+            kw_cap = n + 1;
+        ctx.kw_rows = (INDEX_TYPE *)malloc(kw_cap * sizeof(INDEX_TYPE));
+
+        if (ctx.kw_rows == NULL) {
+            printf("\nError: memory allocation failed!\n\n");
+            free_memory(r);
+            return 0;
+        }
+    }
+
+    if (cache_kb > 0) {
+        tile_w = max(1, (int)((long long)cache_kb * 1024 / (2 * (score_bytes + sym_bytes))));
+        tile_rows = m + e_ins + 2;
+        ctx.tile_col = (int *)malloc(tile_rows * score_bytes);
+
+        if (ctx.tile_col == NULL) {
+            printf("\nError: memory allocation failed!\n\n");
+            free_memory(r);
+            return 0;
+        }
+    }
+
+    if (edits_fname != NULL) {
+        if (ck_c <= 0) ck_c = (m + DEFAULT_CHECKPOINTS - 1) / DEFAULT_CHECKPOINTS;
+        if (ck_c <= 0) ck_c = 1;
+        ck_cap = (m + e_ins) / ck_c + 1;
+        ck_f = (int *)malloc((long long)ck_cap * (n + 1) * sizeof(int));
+        ck_b = (int *)malloc((long long)ck_cap * (n + 1) * sizeof(int));
 
-    XR = (SYMBOL_TYPE *)malloc((m + 2) * sizeof(SYMBOL_TYPE));
-    YR = (SYMBOL_TYPE *)malloc((n + 2) * sizeof(SYMBOL_TYPE));
+        if ((ck_f == NULL) || (ck_b == NULL)) {
+            printf("\nError: memory allocation failed!\n\n");
+            free_memory(r);
+            return 0;
+        }
+    }
 
-    L1 = (int *)malloc((n + 2) * sizeof(int));
-    L2 = (int *)malloc((n + 2) * sizeof(int));
+    if (par_on) {
+        if (align_fp != NULL) ppos = (INDEX_TYPE *)malloc(2 * (mm + 2) * sizeof(INDEX_TYPE));
+        if (par_verify) zv = (SYMBOL_TYPE *)malloc((mm + 2) * sym_bytes);
 
-    clen = (int *)malloc((b + 1) * (b + 1) * sizeof(int));
+        if (((align_fp != NULL) && (ppos == NULL)) || (par_verify && (zv == NULL))) {
+            printf("\nError: memory allocation failed!\n\n");
+            free_memory(r);
+            return 0;
+        }
+    }
+
+    if ((rle_mode != RLE_OFF) && !rle_alloc(m)) {
+        printf("\nError: memory allocation failed!\n\n");
+        free_memory(r);
+        return 0;
+    }
+
+    if (anchor_k > 0) {
+        atsize = 1;
+        alog = 0;
+        while (atsize < 2 * m) {
+            atsize <<= 1;
+            alog++;
+        }
+
+        ahead = (INDEX_TYPE *)malloc(atsize * sizeof(INDEX_TYPE));
+        anext = (INDEX_TYPE *)malloc((m + 2) * sizeof(INDEX_TYPE));
+        acx = (int *)malloc((m + 2) * sizeof(int));
+        acy = (int *)malloc((m + 2) * sizeof(int));
+        apy = (INDEX_TYPE *)malloc((m + 2) * sizeof(INDEX_TYPE));
+        fi = (INDEX_TYPE *)malloc((m + 2) * sizeof(INDEX_TYPE));
+        fj = (INDEX_TYPE *)malloc((m + 2) * sizeof(INDEX_TYPE));
+        fl = (INDEX_TYPE *)malloc((m + 2) * sizeof(INDEX_TYPE));
+        fbest = (INDEX_TYPE *)malloc((m + 2) * sizeof(INDEX_TYPE));
+        fprev = (INDEX_TYPE *)malloc((m + 2) * sizeof(INDEX_TYPE));
+        ford = (INDEX_TYPE *)malloc((m + 2) * sizeof(INDEX_TYPE));
+        fen = (INDEX_TYPE *)malloc((n + 2) * sizeof(INDEX_TYPE));
+        goff = (INDEX_TYPE *)malloc((m + 3) * sizeof(INDEX_TYPE));
+        glen = (INDEX_TYPE *)malloc((m + 3) * sizeof(INDEX_TYPE));
+        zg = (SYMBOL_TYPE *)malloc((mm + m + 3) * sizeof(SYMBOL_TYPE));
+        if (align_fp != NULL) gpos = (INDEX_TYPE *)malloc(2 * (mm + m + 3) * sizeof(INDEX_TYPE));
+
+        if ((ahead == NULL) || (anext == NULL) || (acx == NULL) || (acy == NULL) || (apy == NULL) ||
+            (fi == NULL) || (fj == NULL) || (fl == NULL) || (fbest == NULL) || (fprev == NULL) ||
+            (ford == NULL) || (fen == NULL) || (goff == NULL) || (glen == NULL) || (zg == NULL) ||
+            ((align_fp != NULL) && (gpos == NULL))) {
+            printf("\nError: memory allocation failed!\n\n");
+            free_memory(r);
+            return 0;
+        }
+    }
 
     XS = (char **)malloc((r) * sizeof(char *));
     YS = (char **)malloc((r) * sizeof(char *));
 
-    nxs = (int *)malloc((r) * sizeof(int));
-    nys = (int *)malloc((r) * sizeof(int));
-
-    K = (int **)malloc(2 * sizeof(int *));
+    nxs = (INDEX_TYPE *)malloc((r) * sizeof(INDEX_TYPE));
+    nys = (INDEX_TYPE *)malloc((r) * sizeof(INDEX_TYPE));
 
     ru = (struct rusage *)malloc((r + 1) * sizeof(struct rusage));
     zps = (int *)malloc((r) * sizeof(int));
 
-    if ((Z == NULL) || (XR == NULL) || (YR == NULL) || (L1 == NULL) || (L2 == NULL) ||
-        (XS == NULL) || (YS == NULL) || (K == NULL) || (nxs == NULL) || (nys == NULL) ||
-        (clen == NULL) || (ru == NULL) || (zps == NULL)) {
+    if ((ctx.Z == NULL) || (XR == NULL) || (YR == NULL) || (ctx.L1 == NULL) || (ctx.L2 == NULL) ||
+        (XS == NULL) || (YS == NULL) || (nxs == NULL) || (nys == NULL) ||
+        (ctx.clen == NULL) || ((samples > 0) && (ests == NULL)) || ((align_fp != NULL) && (ctx.apos == NULL)) || (ru == NULL) || (zps == NULL)) {
         printf("\nError: memory allocation failed!\n\n");
         free_memory(r);
         return 0;
     }
 
     for (i = 0; i < r; i++) {
-        XS[i] = (char *)malloc((m + 2) * sizeof(char));
-        YS[i] = (char *)malloc((n + 2) * sizeof(char));
+        XS[i] = (char *)malloc((m + e_ins + 2) * sym_bytes);
+        YS[i] = (char *)malloc((n + 2) * sym_bytes);
 
         if ((XS[i] == NULL) || (YS[i] == NULL)) {
             printf("\nError: memory allocation failed!\n\n");
@@ -146,15 +452,23 @@ int allocate_memory(int m, int n, int r, int b) {
     }
 
     for (i = 0; i < 2; i++) {
-        K[i] = (int *)malloc((n + 2) * sizeof(int));
+        ctx.K[i] = (int *)malloc((n + 2) * score_bytes);
 
-        if (K[i] == NULL) {
+        if (ctx.K[i] == NULL) {
             printf("\nError: memory allocation failed!\n\n");
             free_memory(r);
             return 0;
         }
     }
 
+    ctx_setup();
+
+    if ((split_mode == SPLIT_KWAY) && !lcs_reserve(&ctx, &ctx.cuts, kw_cut_words(m + e_ins) * sizeof(INDEX_TYPE))) {
+        printf("\nError: memory allocation failed!\n\n");
+        free_memory(r);
+        return 0;
+    }
+
     return 1;
 }
 
@@ -183,7 +497,7 @@ int read_data_sep(int r) {
     for (i = 0; i < r; i++) {
         if (fscanf(fp, "%s\n", XS[i] + 1) != 1) return 0;
         nxs[i] = strlen(XS[i] + 1);
-        printf("|X| = %d\n", nxs[i]);
+        printf("|X| = %lld\n", nxs[i]);
     }
     fclose(fp);
 
@@ -192,27 +506,79 @@ int read_data_sep(int r) {
     for (i = 0; i < r; i++) {
         if (fscanf(fp, "%s\n", YS[i] + 1) != 1) return 0;
         nys[i] = strlen(YS[i] + 1);
-        printf("|Y| = %d\n", nys[i]);
+        printf("|Y| = %lld\n", nys[i]);
     }
     fclose(fp);
 
     return 1;
 }
 
-int get_m_n_sep(int *m, int *n) {
+int get_m_n_sep(INDEX_TYPE *m, INDEX_TYPE *n) {
     FILE *fp;
 
     if ((fp = fopen(fname1, "r")) == NULL) return 0;
-    if (fscanf(fp, "%d", m) != 1) return 0;
+    if (fscanf(fp, "%lld", m) != 1) return 0;
     fclose(fp);
 
     if ((fp = fopen(fname2, "r")) == NULL) return 0;
-    if (fscanf(fp, "%d", n) != 1) return 0;
+    if (fscanf(fp, "%lld", n) != 1) return 0;
     fclose(fp);
 
     return 1;
 }
 
+/*
+Codes the alphabet header, or without one the symbols of the r pairs, and
+selects the row kernel; 0 if a pair has a symbol outside the header.
+*/
+int code_alphabet(int r) {
+    INDEX_TYPE k;
+    int i;
+
+    alpha_reset(&amap);
+    alpha_derived = (alpha[0] == 0);
+    alpha_add(&amap, alpha, strlen(alpha));
+
+    for (i = 0; i < r; i++) {
+        if (alpha_derived) {
+            alpha_add(&amap, XS[i] + 1, nxs[i]);
+            alpha_add(&amap, YS[i] + 1, nys[i]);
+        } else if ((k = alpha_find(&amap, XS[i] + 1, nxs[i])) >= 0) {
+            printf("\nError: symbol '%c' at X[%lld] of pair %d is not in the alphabet %s!\n", XS[i][k + 1], k + 1,
+                   i + 1, alpha);
+            return 0;
+        } else if ((k = alpha_find(&amap, YS[i] + 1, nys[i])) >= 0) {
+            printf("\nError: symbol '%c' at Y[%lld] of pair %d is not in the alphabet %s!\n", YS[i][k + 1], k + 1,
+                   i + 1, alpha);
+            return 0;
+        }
+    }
+
+    alpha_select(&amap, alpha_mode);
+
+    return 1;
+}
+
+/* The token IDs of the two files into every pair, as symbols of sym_bytes. */
+void read_tokens(int r) {
+    int i;
+
+    for (i = 0; i < r; i++) {
+        if (sym_bytes == 4) {
+            tok_store<uint32_t>(XS[i], tok_x, tok_nx);
+            tok_store<uint32_t>(YS[i], tok_y, tok_ny);
+        } else if (sym_bytes == 2) {
+            tok_store<uint16_t>(XS[i], tok_x, tok_nx);
+            tok_store<uint16_t>(YS[i], tok_y, tok_ny);
+        } else {
+            tok_store<SYMBOL_TYPE>(XS[i], tok_x, tok_nx);
+            tok_store<SYMBOL_TYPE>(YS[i], tok_y, tok_ny);
+        }
+        nxs[i] = tok_nx;
+        nys[i] = tok_ny;
+    }
+}
+
 void copy_seq(int j) {
     int i;
 
@@ -221,140 +587,981 @@ void copy_seq(int j) {
 
     X = XS[j];
     Y = YS[j];
+
+    ctx.X = X + sym_bytes;
+    ctx.Y = Y + sym_bytes;
+}
+
+/*
+ALG_C over runs: X is split at its middle run boundary and both halves are
+scored with ALG_B_rle, so a level costs O(m N + M n) in run counts. A single
+run on either side is solved directly (its symbol matched greedily against
+the other side), and subproblems whose run counts no longer pay off drop
+back to the plain ALG_C.
+*/
+template <class V>
+void ALG_C_rle(INDEX_TYPE m, INDEX_TYPE n, SYMBOL_TYPE *XX, SYMBOL_TYPE *YY, SYMBOL_TYPE *XXR, SYMBOL_TYPE *YYR) {
+    INDEX_TYPE i, j, k, rx, ry;
+    V *LA = (V *)ctx.L1, *LB = (V *)ctx.L2;
+
+    if ((m == 0) || (n == 0)) return;
+
+    rx = rle_runs(XX, m);
+    ry = rle_runs(YY, n);
+
+    if (rx == 1) {
+        for (i = j = 0; (j < n) && (i < m); j++) {
+            if (YY[j] == XX[0]) {
+                ctx.Z[++ctx.zp] = XX[0];
+                if (ctx.match != NULL) lcs_emit(&ctx, XX - X + i, YY - Y + j);
+                i++;
+            }
+        }
+    } else if (ry == 1) {
+        for (i = j = 0; (i < m) && (j < n); i++) {
+            if (XX[i] == YY[0]) {
+                ctx.Z[++ctx.zp] = YY[0];
+                if (ctx.match != NULL) lcs_emit(&ctx, XX - X + i, YY - Y + j);
+                j++;
+            }
+        }
+    } else if (((n <= BASE_N) && (m <= BASE_N)) || !rle_pays(m, n, rx, ry)) {
+        ALG_C_fit<SYMBOL_TYPE, V>(&ctx, m, n, XX, YY, XXR, YYR);
+    } else {
+        for (i = 1, k = 1; k <= rx / 2; i++)
+            if (XX[i] != XX[i - 1]) k++;
+        i--;
+
+        ALG_B_rle(i, n, XX, YY, LA);
+        ALG_B_rle(m - i, n, XXR, YYR, LB);
+
+        k = split_point(n, LA, LB);
+
+        ALG_C_rle<V>(i, k, XX, YY, XXR + m - i, YYR + n - k);
+        ALG_C_rle<V>(m - i, n - k, XX + i, YY + k, XXR, YYR);
+    }
+}
+
+void worker_free(void);
+
+/* Per-thread ALG_C context, with buffers for rows of up to nb columns; 0 (and worker_failed) if out of memory. */
+int worker_alloc(INDEX_TYPE nb) {
+    ctx_setup();
+    ctx.K[0] = (int *)malloc((nb + 2) * score_bytes);
+    ctx.K[1] = (int *)malloc((nb + 2) * score_bytes);
+    ctx.L1 = (int *)malloc((nb + 2) * score_bytes);
+    ctx.L2 = (int *)malloc((nb + 2) * score_bytes);
+    ctx.clen = (int *)malloc((BASE_N + 1) * (BASE_N + 1) * score_bytes);
+    ctx.apos = (INDEX_TYPE *)malloc(2 * (BASE_N + 1) * sizeof(INDEX_TYPE));
+    if (split_mode != SPLIT_CLASSIC) ctx.kw_rows = (INDEX_TYPE *)malloc(kw_cap * sizeof(INDEX_TYPE));
+    if (cache_kb > 0) ctx.tile_col = (int *)malloc(tile_rows * score_bytes);
+
+    if ((ctx.K[0] == NULL) || (ctx.K[1] == NULL) || (ctx.L1 == NULL) || (ctx.L2 == NULL) || (ctx.clen == NULL) ||
+        (ctx.apos == NULL) || ((split_mode != SPLIT_CLASSIC) && (ctx.kw_rows == NULL)) ||
+        ((split_mode == SPLIT_KWAY) && !lcs_reserve(&ctx, &ctx.cuts, kw_cut_words(nx) * sizeof(INDEX_TYPE))) ||
+        ((cache_kb > 0) && (ctx.tile_col == NULL))) {
+        worker_free();
+        worker_failed = 1;
+        return 0;
+    }
+
+    return 1;
+}
+
+void worker_free(void) {
+    free(ctx.K[0]);
+    free(ctx.K[1]);
+    free(ctx.L1);
+    free(ctx.L2);
+    free(ctx.clen);
+    free(ctx.apos);
+    if (ctx.kw_rows != NULL) free(ctx.kw_rows);
+    if (ctx.tile_col != NULL) free(ctx.tile_col);
+    lcs_unreserve(&ctx, &ctx.masks);
+    lcs_unreserve(&ctx, &ctx.cuts);
+}
+
+/* Forward scan for ALG_C_par, on its own thread: needs no K rows, only the masks of its own context. */
+template <class T, class V>
+void par_scan(INDEX_TYPE m, INDEX_TYPE n, T *XX, T *YY, V *LL) {
+    INDEX_TYPE j;
+    int done;
+
+    ctx.a = lcs_sys;
+    ctx.alpha = &amap;
+    done = lcs_rows(&ctx, m, n, XX, YY, LL);
+    lcs_unreserve(&ctx, &ctx.masks);
+    if (done) return;
+
+    for (j = 0; j <= n; j++) LL[j] = 0;
+    row_advance(XX, m, 1, YY, n, LL);
+}
+
+template <class T, class V>
+void ALG_C_par(INDEX_TYPE m, INDEX_TYPE n, T *XX, T *YY, T *XXR, T *YYR, int depth);
+
+/* First half of a split, on its own thread, writing Z from ZZ + 1 and matches from pp. */
+template <class T, class V>
+void par_task(INDEX_TYPE m, INDEX_TYPE n, T *XX, T *YY, T *XXR, T *YYR, int depth, T *ZZ, INDEX_TYPE *pp) {
+    if (!worker_alloc(n)) return;
+
+    ctx.Z = (SYMBOL_TYPE *)ZZ;
+    ctx.zp = 0;
+    ctx.mpos = pp;
+    ctx.mp = 0;
+    ALG_C_par<T, V>(m, n, XX, YY, XXR, YYR, depth);
+
+    worker_free();
+}
+
+/*
+Deterministic parallel ALG_C. The two scans of a split run on two threads
+and the column comes from split_point(), so every level splits exactly as
+the sequential ALG_C does. The first half then fills Z[zp + 1 ..
+zp + L1[k]] (its length is L1[k]) on a new thread while this one fills the
+rest, so the Z segments and match lists land in order without a merge
+pass, and Z is byte-identical for every thread count. Below depth
+par_depth, or for fewer than PAR_MIN_CELLS cells, it is plain ALG_C.
+*/
+template <class T, class V>
+void ALG_C_par(INDEX_TYPE m, INDEX_TYPE n, T *XX, T *YY, T *XXR, T *YYR, int depth) {
+    INDEX_TYPE i, k;
+    int l;
+    V *LA = (V *)ctx.L1, *LB = (V *)ctx.L2;
+
+    if ((depth >= par_depth) || (m * n < PAR_MIN_CELLS) || (m <= BASE_N) || (n <= BASE_N)) {
+        ALG_C_fit<T, V>(&ctx, m, n, XX, YY, XXR, YYR);
+        return;
+    }
+
+    score_cells[sizeof(V) == sizeof(uint16_t)] += m * n;
+
+    i = m >> 1;
+
+    std::thread fw(par_scan<T, V>, i, n, XX, YY, LA);
+    ALG_B(&ctx, m - i, n, XXR, YYR, LB);
+    fw.join();
+
+    k = split_point(n, LA, LB);
+    l = LA[k];
+
+    par_tasks++;
+    std::thread first(par_task<T, V>, i, k, XX, YY, XXR + m - i, YYR + n - k, depth + 1, (T *)ctx.Z + ctx.zp,
+                      (ctx.mpos != NULL) ? ctx.mpos + ctx.mp : NULL);
+    ctx.zp += l;
+    if (ctx.mpos != NULL) ctx.mp += 2 * l;
+    ALG_C_par<T, V>(m - i, n - k, XX + i, YY + k, XXR, YYR, depth + 1);
+    first.join();
 }
 
-void ALG_B(int m, int n, SYMBOL_TYPE *XX, SYMBOL_TYPE *YY, int *LL) {
-    int i, j;
+/*
+Decision mode: the forward ALG_B scan over all of X, stopping as soon as
+LCS >= threshold is settled. Every path to (m, n) crosses row i, so
+max(K[1][j] + min(m - i, n - j)) over the row bounds the LCS from above.
+The bound costs a row, so it is only evaluated every DECIDE_ROWS rows.
+*/
+#define DECIDE_ROWS 8
+
+template <class T>
+int lcs_hirschberg_decide(double *frac) {
+    INDEX_TYPE i, j, v, bound;
+    T *XX = (T *)X, *YY = (T *)Y;
+
+    answer = -1;
 
-    for (j = 0; j <= n; j++) {
-        K[1][j] = 0;
+    for (j = 0; j <= ny; j++) {
+        ctx.K[1][j] = 0;
     }
 
-    for (i = 1; i <= m; i++) {
-        for (j = 0; j <= n; j++) {
-            K[0][j] = K[1][j];
+    for (i = 0; i <= nx; i++) {
+        if (i > 0) {
+            for (j = 0; j <= ny; j++) {
+                ctx.K[0][j] = ctx.K[1][j];
+            }
+            for (j = 1; j <= ny; j++) {
+                if (XX[i] == YY[j]) {
+                    ctx.K[1][j] = ctx.K[0][j - 1] + 1;
+                } else {
+                    ctx.K[1][j] = max(ctx.K[1][j - 1], ctx.K[0][j]);
+                }
+            }
         }
-        for (j = 1; j <= n; j++) {
-            if (XX[i - 1] == YY[j - 1]) {
-                K[1][j] = K[0][j - 1] + 1;
-            } else {
-                K[1][j] = max(K[1][j - 1], K[0][j]);
+
+        if (ctx.K[1][ny] >= threshold) {
+            answer = 1;
+        } else if ((i % DECIDE_ROWS) == 0) {
+            bound = 0;
+            for (j = 0; j <= ny; j++) {
+                v = ctx.K[1][j] + (min(nx - i, ny - j));
+                if (v > bound) bound = v;
             }
+            if (bound < threshold) answer = 0;
         }
+
+        if (answer >= 0) break;
     }
 
-    for (j = 0; j <= n; j++) {
-        LL[j] = K[1][j];
+    if (i >= nx) {
+        answer = (ctx.K[1][ny] >= threshold);
+        *frac = 1.0;
+        return ctx.K[1][ny];
     }
+
+    *frac = (nx > 0) ? i / (double)nx : 0.0;
+
+    return -1;
 }
 
-void ALG_C(int m, int n, SYMBOL_TYPE *XX, SYMBOL_TYPE *YY, SYMBOL_TYPE *XXR, SYMBOL_TYPE *YYR) {
-    int i, j, k, M;
-    SYMBOL_TYPE s;
+/*
+Edit mode: X is curated by a list of point edits ("I pos sym", "D pos",
+"S pos sym", 1-based in the current X) and the LCS length is reported after
+each. ALG_B rows are kept at every ck_c-th prefix and suffix length of X,
+built lazily. An edit at pos leaves the prefixes before pos and the
+suffixes after it untouched, so only the checkpoints covering pos are
+dropped; a query rebuilds both sides up to the checkpoint at pos, finishes
+the suffix row there, and joins the two rows in O(n). An edit then costs
+O((d + ck_c) n) for a distance d from the previous edit, not O(mn).
+*/
+int read_edits(void) {
+    FILE *fp;
+    char op, sym;
+    INDEX_TYPE pos;
+    int k;
+
+    if ((fp = fopen(edits_fname, "r")) == NULL) return 0;
+
+    for (n_edits = 0; fscanf(fp, " %c %lld", &op, &pos) == 2; n_edits++)
+        if (op != 'D') fscanf(fp, " %c", &sym);
+
+    e_op = (char *)malloc((n_edits + 1) * sizeof(char));
+    e_pos = (INDEX_TYPE *)malloc((n_edits + 1) * sizeof(INDEX_TYPE));
+    e_sym = (SYMBOL_TYPE *)malloc((n_edits + 1) * sizeof(SYMBOL_TYPE));
+
+    if ((e_op == NULL) || (e_pos == NULL) || (e_sym == NULL)) {
+        fclose(fp);
+        return 0;
+    }
+
+    rewind(fp);
+    for (k = e_ins = 0; k < n_edits; k++) {
+        if (fscanf(fp, " %c %lld", &e_op[k], &e_pos[k]) != 2) break;
+        e_sym[k] = 0;
+        if ((e_op[k] != 'D') && (fscanf(fp, " %c", &e_sym[k]) != 1)) break;
+        if ((e_op[k] != 'I') && (e_op[k] != 'D') && (e_op[k] != 'S')) break;
+        if (e_op[k] == 'I') e_ins++;
+    }
+    fclose(fp);
+
+    return k == n_edits;
+}
+
+int *ck_row(int *base, int k) { return base + (INDEX_TYPE)k * (ny + 1); }
+
+/* Forward checkpoints 0..k: row k holds the prefix X[1..k ck_c]. */
+void ck_forward(int k) {
+    for (; ck_fv <= k; ck_fv++) {
+        memcpy(ck_row(ck_f, ck_fv), ck_row(ck_f, ck_fv - 1), (ny + 1) * sizeof(int));
+        row_advance(X + (ck_fv - 1) * ck_c + 1, ck_c, 1, Y + 1, ny, ck_row(ck_f, ck_fv));
+        ck_rows += ck_c;
+    }
+}
+
+/* Backward checkpoints 0..k: row k holds the suffix of length k ck_c against reversed Y. */
+void ck_backward(int k) {
+    for (; ck_bv <= k; ck_bv++) {
+        memcpy(ck_row(ck_b, ck_bv), ck_row(ck_b, ck_bv - 1), (ny + 1) * sizeof(int));
+        row_advance(X + nx - (ck_bv - 1) * ck_c, ck_c, -1, YR + 1, ny, ck_row(ck_b, ck_bv));
+        ck_rows += ck_c;
+    }
+}
+
+/* LCS of the current X, joining the rows at the checkpoint nearest the last edit at pos. */
+int ck_query(INDEX_TYPE pos) {
+    INDEX_TYPE a, s, k, j;
+    int M, *F;
+
+    k = (min(pos, nx)) / ck_c;
+    ck_forward(k);
+    F = ck_row(ck_f, k);
+    a = k * ck_c;
+
+    s = nx - a;
+    k = s / ck_c;
+    ck_backward(k);
+    memcpy(ctx.L2, ck_row(ck_b, k), (ny + 1) * sizeof(int));
+    row_advance(X + nx - k * ck_c, s - k * ck_c, -1, YR + 1, ny, ctx.L2);
+    ck_rows += s - k * ck_c;
+
+    for (j = 0, M = 0; j <= ny; j++)
+        if (F[j] + ctx.L2[ny - j] > M) M = F[j] + ctx.L2[ny - j];
 
-    if (n == 0) return;
-    else if ((n <= BASE_N) && (m <= BASE_N)) {
-        for (i = 0; i <= m; i++) {
-            clen[BIDX(0, i)] = 0;
+    return M;
+}
+
+/* Applies edit k to X; returns 0 if its position is out of range. */
+int ck_edit(int k) {
+    INDEX_TYPE pos, keep;
+
+    pos = e_pos[k];
+    if ((pos < 1) || (pos > nx + (e_op[k] == 'I'))) return 0;
+
+    if (e_op[k] == 'I') {
+        memmove(X + pos + 1, X + pos, nx - pos + 2);
+        X[pos] = e_sym[k];
+        keep = nx - pos + 1;
+        nx++;
+    } else if (e_op[k] == 'D') {
+        memmove(X + pos, X + pos + 1, nx - pos + 1);
+        keep = nx - pos;
+        nx--;
+    } else {
+        X[pos] = e_sym[k];
+        keep = nx - pos;
+    }
+
+    ck_fv = min(ck_fv, (pos - 1) / ck_c + 1);
+    ck_bv = min(ck_bv, keep / ck_c + 1);
+
+    return 1;
+}
+
+int lcs_hirschberg_edits(int prn) {
+    INDEX_TYPE i;
+    int l;
+
+    for (i = 1; i <= ny; i++) {
+        YR[i] = Y[ny - i + 1];
+    }
+
+    ck_rows = 0;
+    memset(ck_f, 0, (ny + 1) * sizeof(int));
+    memset(ck_b, 0, (ny + 1) * sizeof(int));
+    ck_fv = ck_bv = 1;
+
+    l = ck_query(nx);
+    if (prn) printf("Edit %d: initial, LCS %d\n", 0, l);
+
+    for (i = 0; i < n_edits; i++) {
+        if (!ck_edit(i)) {
+            printf("\nError: edit %lld (%c %lld) is outside X!\n", i + 1, e_op[i], e_pos[i]);
+            return -1;
         }
-        for (j = 0; j <= n; j++) {
-            clen[BIDX(j, 0)] = 0;
+        l = ck_query(e_pos[i]);
+        if (prn) printf("Edit %lld: %c %lld, LCS %d\n", i + 1, e_op[i], e_pos[i], l);
+    }
+
+    return l;
+}
+
+/* LCS ratio of the wx x wy window of X, Y at (px, py), by ALG_B. */
+template <class T>
+double lcs_hirschberg_window(INDEX_TYPE px, INDEX_TYPE py, INDEX_TYPE wx, INDEX_TYPE wy) {
+    if (score_bytes == sizeof(uint16_t)) {
+        ALG_B(&ctx, wx, wy, (T *)X + 1 + px, (T *)Y + 1 + py, (uint16_t *)ctx.L1);
+        return ((uint16_t *)ctx.L1)[wy] / (double)(min(wx, wy));
+    }
+
+    ALG_B(&ctx, wx, wy, (T *)X + 1 + px, (T *)Y + 1 + py, ctx.L1);
+    return ctx.L1[wy] / (double)(min(wx, wy));
+}
+
+/*
+Pre-triage estimate of LCS / min(nx, ny): ALG_B on stratified window pairs
+along the main diagonal, extrapolated to the pair (see util.h). Windows keep
+the aspect ratio of the pair.
+*/
+template <class T>
+double lcs_hirschberg_estimate(double *err) {
+    INDEX_TYPE px, py, wx, wy, sx, sy;
+    int k;
+    double t, mean, f, rs, rl;
+
+    estimate_sides(nx, ny, ESTIMATE_WINDOW, &wx, &wy);
+    estimate_sides(nx, ny, ESTIMATE_INNER, &sx, &sy);
+    f = estimate_factor(min(sx, sy), min(wx, wy), min(nx, ny));
+
+    for (k = 0; k < samples; k++) {
+        t = (k + estimate_rand()) / samples;
+        px = (INDEX_TYPE)(t * (nx - wx));
+        py = (INDEX_TYPE)(t * (ny - wy));
+        rl = lcs_hirschberg_window<T>(px, py, wx, wy);
+        rs = lcs_hirschberg_window<T>(px + (wx - sx) / 2, py + (wy - sy) / 2, sx, sy);
+        ests[k] = estimate_sample(rs, rl, f);
+    }
+
+    summarize_samples(ests, samples, &mean, err);
+
+    return mean;
+}
+
+template <class T>
+int lcs_hirschberg(void) {
+    INDEX_TYPE i;
+    T *XX = (T *)X, *YY = (T *)Y, *XXR = (T *)XR, *YYR = (T *)YR;
+
+    for (i = 1; i <= nx; i++) {
+        XXR[i] = XX[nx - i + 1];
+    }
+    XXR[nx + 1] = 0;
+
+    for (i = 1; i <= ny; i++) {
+        YYR[i] = YY[ny - i + 1];
+    }
+    YYR[ny + 1] = 0;
+
+    ctx.zp = 0;
+    rle_used = 0;
+    if (rle_mode != RLE_OFF) {
+        rle_x = rle_runs(X + 1, nx);
+        rle_y = rle_runs(Y + 1, ny);
+        rle_used = (rle_mode == RLE_ON) || rle_pays(nx, ny, rle_x, rle_y);
+    }
+
+    if (rle_used && (score_bytes == sizeof(uint16_t)))
+        ALG_C_rle<uint16_t>(nx, ny, X + 1, Y + 1, XR + 1, YR + 1);
+    else if (rle_used)
+        ALG_C_rle<int>(nx, ny, X + 1, Y + 1, XR + 1, YR + 1);
+    else if (par_on) {
+        par_tasks = 0;
+        ctx.mpos = ppos;
+        ctx.mp = 0;
+        if (score_bytes == sizeof(uint16_t))
+            ALG_C_par<T, uint16_t>(nx, ny, XX + 1, YY + 1, XXR + 1, YYR + 1, 0);
+        else
+            ALG_C_par<T, int>(nx, ny, XX + 1, YY + 1, XXR + 1, YYR + 1, 0);
+        ctx.mpos = NULL;
+        if (worker_failed) return -1;
+        if (ppos != NULL)
+            for (i = 0; i < 2 * ctx.zp; i += 2) align_match(ppos[i], ppos[i + 1]);
+    } else
+        ALG_C_fit<T, int>(&ctx, nx, ny, XX + 1, YY + 1, XXR + 1, YYR + 1);
+
+    ((T *)ctx.Z)[ctx.zp + 1] = 0;
+
+    return ctx.zp;
+}
+
+/*
+Reruns the pair with the sequential ALG_C and compares its Z with the
+parallel one of length l. Returns 0 if they are identical, else the first
+position (1-based) at which they differ.
+*/
+template <class T>
+int lcs_hirschberg_verify(int l) {
+    int i, q;
+    void (*match)(struct lcs_ctx *, INDEX_TYPE, INDEX_TYPE) = ctx.match;
+
+    memcpy(zv, ctx.Z, (l + 2) * sizeof(T));
+
+    ctx.match = NULL;
+    par_on = 0;
+    q = lcs_hirschberg<T>();
+    par_on = 1;
+    ctx.match = match;
+
+    for (i = 1; (i <= l) && (i <= q); i++)
+        if (((T *)zv)[i] != ((T *)ctx.Z)[i]) return i;
+
+    return (q == l) ? 0 : min(l, q) + 1;
+}
+
+void ilv_push(struct ilv_pair *p, INDEX_TYPE m, INDEX_TYPE n, SYMBOL_TYPE *XX, SYMBOL_TYPE *YY, SYMBOL_TYPE *XXR,
+              SYMBOL_TYPE *YYR) {
+    struct ilv_frame *f = &p->stk[++p->top];
+
+    f->m = m;
+    f->n = n;
+    f->XX = XX;
+    f->YY = YY;
+    f->XXR = XXR;
+    f->YYR = YYR;
+    f->phase = 0;
+}
+
+/* Touches the next tile of the top subproblem so that it is in cache when the pair resumes. */
+void ilv_prefetch(struct ilv_pair *p) {
+    struct ilv_frame *f;
+    INDEX_TYPE j;
+    int *LL;
+
+    if (p->top < 0) return;
+    f = &p->stk[p->top];
+    LL = (f->phase == 2) ? p->L2 : p->L1;
+
+    for (j = 0; (j <= f->n) && (j < PREFETCH_LINES * 16); j += 16) __builtin_prefetch(LL + j, 1);
+    __builtin_prefetch((f->phase == 2) ? f->XXR + f->r : f->XX + f->r);
+    __builtin_prefetch(f->YY);
+}
+
+/* One step of pair p's ALG_C; returns 0 once its stack is empty. */
+int ilv_step(struct ilv_pair *p) {
+    struct ilv_frame *f;
+    INDEX_TYPE j, k, rows, m, n;
+    SYMBOL_TYPE *XX, *YY, *XXR, *YYR;
+
+    if (p->top < 0) return 0;
+    f = &p->stk[p->top];
+
+    if (f->phase == 0) {
+        if ((f->n == 0) || (f->m == 1) || ((f->m <= BASE_N) && (f->n <= BASE_N))) {
+            ALG_C_fit<SYMBOL_TYPE, int>(&ctx, f->m, f->n, f->XX, f->YY, f->XXR, f->YYR);
+            p->top--;
+            ilv_prefetch(p);
+            return 1;
         }
+        f->i = f->m >> 1;
+        f->r = 0;
+        f->phase = 1;
+        for (j = 0; j <= f->n; j++) p->L1[j] = p->L2[j] = 0;
+    }
 
-        for (j = 1; j <= n; j++) {
-            for (i = 1, k = BIDX(j, 1); i <= m; i++, k++) {
-                if (XX[i - 1] == YY[j - 1]) {
-                    clen[k] = clen[k - BASE_N - 2] + 1;
-                } else {
-                    clen[k] = max(clen[k - BASE_N - 1], clen[k - 1]);
-                }
-            }
+    rows = TILE_CELLS / (f->n + 1);
+    if (rows < 1) rows = 1;
+
+    if (f->phase == 1) {
+        rows = min(rows, f->i - f->r);
+        row_advance(f->XX + f->r, rows, 1, f->YY, f->n, p->L1);
+        f->r += rows;
+        if (f->r == f->i) {
+            f->r = 0;
+            f->phase = 2;
         }
+    } else if (f->phase == 2) {
+        rows = min(rows, f->m - f->i - f->r);
+        row_advance(f->XXR + f->r, rows, 1, f->YYR, f->n, p->L2);
+        f->r += rows;
+        if (f->r == f->m - f->i) f->phase = 3;
+    } else {
+        m = f->m;
+        n = f->n;
+        XX = f->XX;
+        YY = f->YY;
+        XXR = f->XXR;
+        YYR = f->YYR;
+
+        k = split_point(n, p->L1, p->L2);
+
+        p->top--;
+        ilv_push(p, m - f->i, n - k, XX + f->i, YY + k, XXR, YYR);
+        ilv_push(p, f->i, k, XX, YY, XXR + m - f->i, YYR + n - k);
+    }
 
-        i = m;
-        j = n;
-        k = zp;
+    ilv_prefetch(p);
 
-        while ((i > 0) && (j > 0)) {
-            if (XX[i - 1] == YY[j - 1]) {
-                Z[++zp] = XX[i - 1];
-                i--;
-                j--;
-            } else if (clen[BIDX(j - 1, i)] > clen[BIDX(j, i - 1)]) {
-                j--;
-            } else {
-                i--;
-            }
+    return 1;
+}
+
+/*
+Runs pairs first .. first + cnt - 1 round-robin on this thread, one step of
+each in turn, and leaves their LCS lengths in zps. The base cases go
+through ALG_C with Z, zp and clen switched to the pair's own.
+*/
+void lcs_hirschberg_interleave(int first, int cnt) {
+    INDEX_TYPE i;
+    int t, live;
+    struct ilv_pair *p;
+    SYMBOL_TYPE *sZ = ctx.Z;
+    int *sclen = ctx.clen;
+
+    for (t = 0; t < cnt; t++) {
+        p = &ilv[t];
+        copy_seq(first + t);
+        for (i = 1; i <= nx; i++) p->XR[i] = X[nx - i + 1];
+        for (i = 1; i <= ny; i++) p->YR[i] = Y[ny - i + 1];
+        p->top = -1;
+        p->zp = 0;
+        ilv_push(p, nx, ny, X + 1, Y + 1, p->XR + 1, p->YR + 1);
+    }
+
+    ilv_steps = 0;
+    for (live = cnt; live > 0;) {
+        for (t = live = 0; t < cnt; t++) {
+            p = &ilv[t];
+            if (p->top < 0) continue;
+            copy_seq(first + t);
+            ctx.Z = p->Z;
+            ctx.zp = p->zp;
+            ctx.clen = p->clen;
+            live += ilv_step(p);
+            p->zp = ctx.zp;
+            ilv_steps++;
         }
+    }
+
+    for (t = 0; t < cnt; t++) {
+        ilv[t].Z[ilv[t].zp + 1] = 0;
+        zps[first + t] = ilv[t].zp;
+    }
+
+    ctx.Z = sZ;
+    ctx.clen = sclen;
+}
 
-        for (i = k + 1, j = zp; i < j; i++, j--) {
-            s = Z[i];
-            Z[i] = Z[j];
-            Z[j] = s;
+/*
+Anchoring front-end for long, similar pairs. k-mers that occur exactly once
+in X and once in Y are the anchors; runs of them on one diagonal are merged
+into fragments, and a maximum-weight colinear chain of non-overlapping
+fragments is taken. Only the gaps between chained fragments go to ALG_C,
+spread over worker threads.
+
+The chain gives a common subsequence of length L, so an optimal path has at
+most D = m + n - 2L unmatched symbols and never strays more than
+(D - |m - n|) / 2 diagonals outside the band between the two corners. In
+exact mode an LCS length pass restricted to that band certifies the chain,
+or the full ALG_C runs if it beats it; fast mode keeps the chain unchecked.
+*/
+#define ANCHOR_HASH_BASE 0x100000001b3ULL
+#define ANCHOR_HASH_MIX 0x9E3779B97F4A7C15ULL
+
+INDEX_TYPE anchor_find(SYMBOL_TYPE *S, INDEX_TYPE p) {
+    INDEX_TYPE q;
+
+    for (q = ahead[p]; q != 0; q = anext[q])
+        if (memcmp(X + q, S, anchor_k) == 0) break;
+
+    return q;
+}
+
+INDEX_TYPE anchor_fragments(void) {
+    INDEX_TYPE i, j, p, q, nf, k = anchor_k;
+    unsigned long long h, pw;
+
+    if ((nx < k) || (ny < k)) return 0;
+
+    for (i = 0; i < atsize; i++) ahead[i] = 0;
+
+    for (i = 1, pw = 1; i < k; i++) pw *= ANCHOR_HASH_BASE;
+
+    for (i = 1, h = 0; i <= nx - k + 1; i++) {
+        if (i == 1)
+            for (j = 1; j <= k; j++) h = h * ANCHOR_HASH_BASE + (unsigned char)X[j];
+        else
+            h = (h - (unsigned char)X[i - 1] * pw) * ANCHOR_HASH_BASE + (unsigned char)X[i + k - 1];
+        p = (INDEX_TYPE)((h * ANCHOR_HASH_MIX) >> (64 - alog));
+        acx[i] = 0;
+        if ((q = anchor_find(X + i, p)) != 0)
+            acx[q]++;
+        else {
+            anext[i] = ahead[p];
+            ahead[p] = i;
+            acx[i] = 1;
+            acy[i] = 0;
         }
     }
-    else if (m == 1) {
-        for (j = 1; j <= n; j++) {
-            if (XX[0] == YY[j - 1]) break;
+
+    for (j = 1, h = 0; j <= ny - k + 1; j++) {
+        if (j == 1)
+            for (i = 1; i <= k; i++) h = h * ANCHOR_HASH_BASE + (unsigned char)Y[i];
+        else
+            h = (h - (unsigned char)Y[j - 1] * pw) * ANCHOR_HASH_BASE + (unsigned char)Y[j + k - 1];
+        p = (INDEX_TYPE)((h * ANCHOR_HASH_MIX) >> (64 - alog));
+        if ((q = anchor_find(Y + j, p)) != 0) {
+            acy[q]++;
+            apy[q] = j;
         }
-        if (j <= n) Z[++zp] = XX[0];
-    } else {
-        i = m >> 1;
+    }
 
-        ALG_B(i, n, XX, YY, L1);
-        ALG_B(m - i, n, XXR, YYR, L2);
+    // unique in both, in X order; a run on one diagonal becomes one fragment
+    for (i = 1, nf = 0; i <= nx - k + 1; i++) {
+        if ((acx[i] != 1) || (acy[i] != 1)) continue;
+        j = apy[i];
+        if ((nf > 0) && (j - i == fj[nf - 1] - fi[nf - 1]) && (i <= fi[nf - 1] + fl[nf - 1]))
+            fl[nf - 1] = i + k - fi[nf - 1];
+        else {
+            fi[nf] = i;
+            fj[nf] = j;
+            fl[nf] = k;
+            nf++;
+        }
+    }
 
-        M = 0;
-        k = -1;
-        for (j = 0; j <= n; j++) {
-            if (L1[j] + L2[n - j] > M) {
-                k = j;
-                M = L1[j] + L2[n - j];
-            }
+    return nf;
+}
+
+int cmp_fend(const void *a, const void *b) {
+    INDEX_TYPE u = *(const INDEX_TYPE *)a, v = *(const INDEX_TYPE *)b;
+
+    return (fi[u] + fl[u] > fi[v] + fl[v]) - (fi[u] + fl[u] < fi[v] + fl[v]);
+}
+
+/* Heaviest chain by a sweep over X with a prefix-max Fenwick tree on the Y end; returns its last fragment. */
+INDEX_TYPE anchor_chain(INDEX_TYPE nf) {
+    INDEX_TYPE t, u, g, b, v;
+
+    for (t = 0; t < nf; t++) ford[t] = t;
+    qsort(ford, nf, sizeof(INDEX_TYPE), cmp_fend);
+
+    for (v = 0; v <= ny; v++) fen[v] = -1;
+
+    for (t = u = 0, b = -1; t < nf; t++) {
+        while ((u < nf) && (fi[ford[u]] + fl[ford[u]] <= fi[t])) {
+            g = ford[u++];
+            for (v = fj[g] + fl[g] - 1; v <= ny; v += v & (-v))
+                if ((fen[v] < 0) || (fbest[fen[v]] < fbest[g])) fen[v] = g;
         }
 
-        ALG_C(i, k, XX, YY, XXR + m - i, YYR + n - k);
-        ALG_C(m - i, n - k, XX + i, YY + k, XXR, YYR);
+        fprev[t] = -1;
+        for (v = fj[t] - 1; v > 0; v -= v & (-v))
+            if ((fen[v] >= 0) && ((fprev[t] < 0) || (fbest[fen[v]] > fbest[fprev[t]]))) fprev[t] = fen[v];
+
+        fbest[t] = fl[t] + ((fprev[t] >= 0) ? fbest[fprev[t]] : 0);
+        if ((b < 0) || (fbest[t] > fbest[b])) b = t;
     }
+
+    return b;
 }
 
-int lcs_hirschberg(void) {
-    int i;
+/* Gap t lies between chained fragments t - 1 and t (ford now holds the chain in order). */
+void gap_bounds(INDEX_TYPE t, INDEX_TYPE *a, INDEX_TYPE *c, INDEX_TYPE *gm, INDEX_TYPE *gn) {
+    *a = (t > 0) ? fi[ford[t - 1]] + fl[ford[t - 1]] : 1;
+    *c = (t > 0) ? fj[ford[t - 1]] + fl[ford[t - 1]] : 1;
+    *gm = ((t < a_chain) ? fi[ford[t]] : nx + 1) - *a;
+    *gn = ((t < a_chain) ? fj[ford[t]] : ny + 1) - *c;
+}
+
+void anchor_worker(INDEX_TYPE nb) {
+    INDEX_TYPE t, a, c, gm, gn;
+
+    if (!worker_alloc(nb)) return;
+
+    while ((t = next_gap++) < a_gaps) {
+        gap_bounds(t, &a, &c, &gm, &gn);
+        ctx.Z = zg + goff[t];
+        ctx.zp = 0;
+        ctx.mpos = (gpos != NULL) ? gpos + 2 * goff[t] : NULL;
+        ctx.mp = 0;
+        if ((gm > 0) && (gn > 0))
+            ALG_C_fit<SYMBOL_TYPE, int>(&ctx, gm, gn, X + a, Y + c, XR + nx - (a + gm - 1) + 1, YR + ny - (c + gn - 1) + 1);
+        glen[t] = ctx.zp;
+    }
+
+    worker_free();
+}
+
+/* LCS length over the diagonals lo <= j - i <= hi only, one in-place array indexed by diagonal. */
+int lcs_band_length(INDEX_TYPE lo, INDEX_TYPE hi) {
+    INDEX_TYPE i, d, dl, dh;
+    int l, *buf, *B;
+
+    if ((buf = (int *)malloc((hi - lo + 3) * sizeof(int))) == NULL) return -1;
+    B = buf + 1 - lo;
+
+    for (d = lo - 1; d <= hi + 1; d++) B[d] = (d >= 0) && (d <= ny) ? 0 : INT_MIN / 2;
 
     for (i = 1; i <= nx; i++) {
-        XR[i] = X[nx - i + 1];
+        dl = max(lo, -i);
+        dh = min(hi, ny - i);
+        if (dl == -i) B[dl++] = 0;
+        for (d = dl; d <= dh; d++) {
+            if (X[i] == Y[i + d])
+                B[d] = B[d] + 1;
+            else
+                B[d] = max(B[d - 1], B[d + 1]);
+        }
+    }
+
+    l = B[ny - nx];
+    free(buf);
+
+    return l;
+}
+
+int lcs_hirschberg_anchor(void) {
+    INDEX_TYPE t, q, a, c, gm, gn, nb, l;
+    int nt;
+    std::thread *pool;
+
+    for (t = 1; t <= nx; t++) {
+        XR[t] = X[nx - t + 1];
     }
     XR[nx + 1] = 0;
 
-    for (i = 1; i <= ny; i++) {
-        YR[i] = Y[ny - i + 1];
+    for (t = 1; t <= ny; t++) {
+        YR[t] = Y[ny - t + 1];
     }
     YR[ny + 1] = 0;
 
-    zp = 0;
-    ALG_C(nx, ny, X + 1, Y + 1, XR + 1, YR + 1);
+    a_frag = anchor_fragments();
+    a_chain = 0;
+    a_cover = 0;
+    if (a_frag > 0) {
+        for (t = anchor_chain(a_frag); t >= 0; t = fprev[t]) ford[a_chain++] = t;
+        for (t = 0, q = a_chain - 1; t < q; t++, q--) {
+            l = ford[t];
+            ford[t] = ford[q];
+            ford[q] = l;
+        }
+        for (t = 0; t < a_chain; t++) a_cover += fl[ford[t]];
+    }
+
+    a_gaps = a_chain + 1;
+    a_cells = 0.0;
+    for (t = 0, nb = 0, goff[0] = 0; t < a_gaps; t++) {
+        gap_bounds(t, &a, &c, &gm, &gn);
+        a_cells += (double)gm * gn;
+        if (gn > nb) nb = gn;
+        goff[t + 1] = goff[t] + (min(gm, gn)) + 1;
+    }
+    a_cells = ((nx > 0) && (ny > 0)) ? a_cells / ((double)nx * ny) : 0.0;
+
+    nt = (threads > 0) ? threads : (int)std::thread::hardware_concurrency();
+    if (nt < 1) nt = 1;
+    if (nt > a_gaps) nt = (int)a_gaps;
+
+    next_gap = 0;
+    pool = new std::thread[nt];
+    for (t = 0; t < nt; t++) pool[t] = std::thread(anchor_worker, nb);
+    for (t = 0; t < nt; t++) pool[t].join();
+    delete[] pool;
+    if (worker_failed) return -1;
+
+    ctx.zp = 0;
+    for (t = 0; t < a_gaps; t++) {
+        for (q = 1; q <= glen[t]; q++) ctx.Z[++ctx.zp] = zg[goff[t] + q];
+        if (t < a_chain)
+            for (q = 0; q < fl[ford[t]]; q++) ctx.Z[++ctx.zp] = X[fi[ford[t]] + q];
+    }
+    ctx.Z[ctx.zp + 1] = 0;
+
+    a_exact = -1;
+    if (!anchor_fast) {
+        l = ((nx + ny - 2 * ctx.zp) - llabs(nx - ny)) / 2;
+        a_lo = (min(0, ny - nx)) - l;
+        a_hi = (max(0, ny - nx)) + l;
+        a_check = 0.0;
+        for (t = 1; t <= nx; t++) a_check += (min(a_hi, ny - t)) - (max(a_lo, -t)) + 1;
+        a_check = ((nx > 0) && (ny > 0)) ? a_check / ((double)nx * ny) : 0.0;
+        a_exact = (lcs_band_length(a_lo, a_hi) == ctx.zp);
+        if (!a_exact) return lcs_hirschberg<SYMBOL_TYPE>();
+    }
 
-    Z[zp + 1] = 0;
+    if (align_fp != NULL) {
+        for (t = 0; t < a_gaps; t++) {
+            for (q = 0; q < 2 * glen[t]; q += 2) align_match(gpos[2 * goff[t] + q], gpos[2 * goff[t] + q + 1]);
+            if (t < a_chain)
+                for (q = 0; q < fl[ford[t]]; q++) align_match(fi[ford[t]] + q, fj[ford[t]] + q);
+        }
+    }
 
-    return zp;
+    return ctx.zp;
 }
 
 int main(int argc, char *argv[]) {
-    int i, l, m, n, r, b, prn;
-    double ut, st, tt;
+    INDEX_TYPE m, n;
+    int i, l, r, b, prn, skip;
+    double ut, st, tt, frac, est, err, est_t;
     char str[50];
 
     printf(
         "=====================================================================================\n");
     printf("Program: %s\n", argv[0]);
 
+    for (i = l = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--threshold=", 12) == 0) {
+            threshold = atoi(argv[i] + 12);
+            if (threshold <= 0) threshold = 1;
+        } else if ((strncmp(argv[i], "--align=", 8) == 0) || (strncmp(argv[i], "--cigar=", 8) == 0)) {
+            if (!align_open(argv[i] + 8, argv[i][2] == 'c')) {
+                printf("\nError: cannot open alignment file %s!\n", argv[i] + 8);
+                return 0;
+            }
+        } else if (strncmp(argv[i], "--anchor=", 9) == 0) {
+            anchor_k = atoi(argv[i] + 9);
+            if (anchor_k <= 0) anchor_k = DEFAULT_ANCHOR;
+        } else if (strcmp(argv[i], "--anchor-fast") == 0) {
+            if (anchor_k == 0) anchor_k = DEFAULT_ANCHOR;
+            anchor_fast = 1;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = atoi(argv[i] + 10);
+        } else if (strcmp(argv[i], "--parallel") == 0) {
+            par_on = 1;
+        } else if (strcmp(argv[i], "--verify-deterministic") == 0) {
+            par_on = par_verify = 1;
+        } else if (strncmp(argv[i], "--interleave=", 13) == 0) {
+            interleave = atoi(argv[i] + 13);
+        } else if (strncmp(argv[i], "--edits=", 8) == 0) {
+            edits_fname = argv[i] + 8;
+        } else if (strncmp(argv[i], "--checkpoint=", 13) == 0) {
+            ck_c = atoll(argv[i] + 13);
+        } else if (strncmp(argv[i], "--split=", 8) == 0) {
+            for (split_mode = SPLIT_KWAY; split_mode >= 0; split_mode--)
+                if (strcmp(argv[i] + 8, split_names[split_mode]) == 0) break;
+            if (split_mode < 0) {
+                printf("\nError: unknown split mode %s!\n", argv[i] + 8);
+                return 0;
+            }
+        } else if (strncmp(argv[i], "--mem-budget=", 13) == 0) {
+            kw_budget = atoi(argv[i] + 13);
+            if (kw_budget <= 0) kw_budget = DEFAULT_MEM_BUDGET;
+        } else if (strncmp(argv[i], "--cache-kb=", 11) == 0) {
+            cache_kb = atoi(argv[i] + 11);
+        } else if (strncmp(argv[i], "--score-width=", 14) == 0) {
+            if ((strcmp(argv[i] + 14, "auto") != 0) && (strcmp(argv[i] + 14, "32") != 0)) {
+                printf("\nError: unknown score width %s!\n", argv[i] + 14);
+                return 0;
+            }
+            score_auto = (argv[i][14] == 'a');
+            score_forced = 1;
+        } else if (strncmp(argv[i], "--tokens=", 9) == 0) {
+            for (tok_mode = TOK_WORDS; tok_mode > 0; tok_mode--)
+                if (strcmp(argv[i] + 9, tok_names[tok_mode]) == 0) break;
+            if (tok_mode == TOK_OFF) {
+                printf("\nError: unknown token mode %s!\n", argv[i] + 9);
+                return 0;
+            }
+        } else if (strncmp(argv[i], "--alphabet=", 11) == 0) {
+            for (alpha_mode = ALPHA_OFF; alpha_mode >= 0; alpha_mode--)
+                if (strcmp(argv[i] + 11, alpha_names[alpha_mode]) == 0) break;
+            if (alpha_mode < 0) {
+                printf("\nError: unknown alphabet mode %s!\n", argv[i] + 11);
+                return 0;
+            }
+        } else if (strncmp(argv[i], "--rle=", 6) == 0) {
+            for (rle_mode = RLE_AUTO; rle_mode >= 0; rle_mode--)
+                if (strcmp(argv[i] + 6, rle_names[rle_mode]) == 0) break;
+            if (rle_mode < 0) {
+                printf("\nError: unknown run-length mode %s!\n", argv[i] + 6);
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--estimate") == 0) {
+            if (samples == 0) samples = DEFAULT_SAMPLES;
+        } else if (strncmp(argv[i], "--samples=", 10) == 0) {
+            samples = atoi(argv[i] + 10);
+            if (samples <= 0) samples = DEFAULT_SAMPLES;
+        } else if (strncmp(argv[i], "--min-ratio=", 12) == 0) {
+            min_ratio = atof(argv[i] + 12);
+            if (samples == 0) samples = DEFAULT_SAMPLES;
+        } else
+            argv[l++] = argv[i];
+    }
+    argc = l;
+
     if (argc < 3) {
         printf("\nError: not enough arguments!\n");
         printf("Specify: n ( = length of sequence ) and r ( = number of runs ).\n\n");
+        printf("Options: --threshold=k ( = only decide whether LCS >= k, stopping early ),\n");
+        printf("         --estimate ( = sampled LCS ratio estimate only ), --samples=s,\n");
+        printf("         --min-ratio=q ( = skip pairs whose estimated ratio is clearly below q ),\n");
+        printf("         --align=file / --cigar=file ( = stream match pairs / edit script ),\n");
+        printf("         --anchor=k ( = chain unique k-mer anchors, align only the gaps; exact ),\n");
+        printf("         --anchor-fast ( = keep the chained result unchecked ), --threads=t,\n");
+        printf("         --rle=auto|on|off ( = run-length engine for repetitive inputs; default off ),\n");
+        printf("         --tokens=lines|words ( = -1 file1 file2 r: LCS of the files' lines / words ),\n");
+        printf("         --edits=file ( = LCS length after each point edit to X ), --checkpoint=c,\n");
+        printf("         --split=classic|single|kway ( = ALG_C midpoint by two scans, one scan, or\n");
+        printf("         one scan into k strips ), --mem-budget=MB ( = kept rows for kway; default %d ),\n",
+               DEFAULT_MEM_BUDGET);
+        printf("         --cache-kb=KB ( = ALG_B in column strips sized to a KB cache ),\n");
+        printf("         --score-width=auto|32 ( = 16-bit scores where the LCS fits them; default auto ),\n");
+        printf("         --alphabet=auto|off ( = match-mask ALG_B rows for up to %d symbols; default auto ),\n",
+               ALPHA_MAX_KERNEL);
+        printf("         --interleave=p ( = run p pairs round-robin on one thread, tile by tile ),\n");
+        printf("         --parallel ( = ALG_C on --threads=t threads, same Z as sequential ),\n");
+        printf("         --verify-deterministic ( = --parallel, then check Z against a sequential run ).\n\n");
         return 0;
     }
 
-    n = atoi(argv[1]);
+    n = atoll(argv[1]);
     if (n == -1) {
         fname1 = argv[2];
         fname2 = argv[3];
@@ -366,10 +1573,19 @@ int main(int argc, char *argv[]) {
     m = n;
 
     if (n == 0) {
-        if (scanf("%d %d\n\n", &m, &n) != 2) {
+        if (scanf("%lld %lld\n\n", &m, &n) != 2) {
             printf("\nError: cannot read sequence lengths!\n");
             return 0;
         }
+    } else if ((n == -1) && (tok_mode != TOK_OFF)) {
+        if (!tok_read(fname1, fname2)) {
+            printf("\nError: cannot read tokens from %s and %s!\n", fname1, fname2);
+            tok_free();
+            return 0;
+        }
+        m = tok_nx;
+        n = tok_ny;
+        sym_bytes = tok_width();
     } else if (n == -1) {
         if (!get_m_n_sep(&m, &n)) {
             printf("\nError: cannot read sequence lengths!\n");
@@ -377,24 +1593,61 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if ((min(m, n)) > INT_MAX) {
+        printf("\nError: an LCS of more than %d symbols does not fit the int scores!\n", INT_MAX);
+        return 0;
+    }
+
     if (argc > b + 3) {
         BASE_N = atoi(argv[b + 3]);
         if (BASE_N <= 0) BASE_N = DEFAULT_BASE;
     } else
         BASE_N = DEFAULT_BASE;
 
-    l = BASE_N;
-    LOG_BASE_N = 0;
-    while (l > 1) {
-        l >>= 1;
-        LOG_BASE_N++;
-    }
+    base_kernel = base_slot(BASE_N);
 
     if (argc > b + 4)
         prn = atoi(argv[b + 4]);
     else
         prn = 0;
 
+    if (interleave > r) interleave = r;
+    if ((interleave > 1) && ((align_fp != NULL) || (anchor_k > 0) || (threshold > 0) || (samples > 0) ||
+                             (edits_fname != NULL))) {
+        printf("\nError: --interleave runs the plain ALG_C only (no --align, --anchor, --threshold,\n");
+        printf("       --estimate or --edits)!\n");
+        return 0;
+    }
+
+    if ((tok_mode != TOK_OFF) && ((b == 0) || (anchor_k > 0) || (interleave > 1) || (edits_fname != NULL) ||
+                                  (rle_mode == RLE_ON))) {
+        printf("\nError: --tokens reads two text files ( -1 file1 file2 r ) into the plain ALG_C\n");
+        printf("       (no --anchor, --interleave, --edits or --rle=on)!\n");
+        return 0;
+    }
+    if (sym_bytes > 1) rle_mode = RLE_OFF;
+
+    if (par_on && ((split_mode != SPLIT_CLASSIC) || (interleave > 1))) {
+        printf("\nError: --parallel splits by two scans only (no --split=%s or --interleave)!\n",
+               split_names[split_mode]);
+        return 0;
+    }
+
+    if (par_on) {
+        par_threads = (threads > 0) ? threads : (int)std::thread::hardware_concurrency();
+        for (par_depth = 0; (1 << par_depth) < par_threads; par_depth++)
+            ;
+    }
+
+    if ((edits_fname != NULL) && !read_edits()) {
+        printf("\nError: cannot read edits from %s!\n", edits_fname);
+        return 0;
+    }
+
+    // decision and edit mode keep their rows in int
+    if (score_auto && ((min(m, n)) < SCORE16_LIMIT) && (threshold == 0) && (edits_fname == NULL))
+        score_bytes = sizeof(uint16_t);
+
     if (!allocate_memory(m, n, r, BASE_N)) return 0;
 
     if (b == 0) {
@@ -403,7 +1656,9 @@ int main(int argc, char *argv[]) {
             free_memory(r);
             return 0;
         }
-    } else {
+    } else if (tok_mode != TOK_OFF)
+        read_tokens(r);
+    else {
         if (!read_data_sep(r)) {
             printf("\nError: failed to read data!\n\n");
             free_memory(r);
@@ -411,8 +1666,39 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    printf("m = %d, n = %d\n", m, n);
-    printf("Runs = %d, base case = %d\n", r, BASE_N);
+    if ((tok_mode == TOK_OFF) && !code_alphabet(r)) {
+        free_memory(r);
+        return 0;
+    }
+
+    printf("m = %lld, n = %lld\n", m, n);
+    if (tok_mode != TOK_OFF)
+        printf("Tokens: %s, %u distinct, %d-bit symbols\n", tok_names[tok_mode], tok_distinct, 8 * sym_bytes);
+    printf("Runs = %d, base case = %d (%s kernel)\n", r, BASE_N, base_kernel ? "specialized" : "generic");
+    if ((tok_mode == TOK_OFF) && (amap.kernel > 0))
+        printf("Alphabet: %d symbols (%s), %d-code match-mask rows\n", amap.size, alpha_derived ? "derived" : "header",
+               alpha_sizes[amap.kernel]);
+    else if (tok_mode == TOK_OFF)
+        printf("Alphabet: %d symbols (%s)\n", amap.size, alpha_derived ? "derived" : "header");
+    if ((samples > 0) && (min_ratio <= 0.0))
+        printf("Mode: estimate (%d samples)\n", samples);
+    else if (threshold > 0)
+        printf("Mode: decide LCS >= %d\n", threshold);
+    if (min_ratio > 0.0) printf("Pre-pass: skip if estimated ratio < %.4f\n", min_ratio);
+    if ((split_mode == SPLIT_KWAY) && (threshold == 0) && (edits_fname == NULL))
+        printf("Split: kway, %d MB budget, up to %lld strips\n", kw_budget, min(m, kw_cap / (n + 1) + 1));
+    else if ((split_mode != SPLIT_CLASSIC) && (threshold == 0) && (edits_fname == NULL))
+        printf("Split: %s\n", split_names[split_mode]);
+    if (cache_kb > 0) printf("Tiling: ALG_B in strips of %d columns (%d KB cache)\n", tile_w, cache_kb);
+    if (interleave > 1) printf("Interleave: %d pairs per batch, %d-cell tiles\n", interleave, TILE_CELLS);
+    if (par_on && (threshold == 0) && (edits_fname == NULL))
+        printf("Parallel: deterministic, %d threads (split depth %d)%s\n", par_threads, par_depth,
+               par_verify ? ", verified" : "");
+    if (edits_fname != NULL) printf("Mode: %d edits to X, checkpoint every %lld rows\n", n_edits, ck_c);
+    if ((anchor_k > 0) && (threshold == 0))
+        printf("Anchoring: k = %d, %s\n", anchor_k, anchor_fast ? "fast (unchecked)" : "exact");
+    if ((align_fp != NULL) && (threshold > 0)) printf("Alignment: not written in decision mode\n");
+    if ((rle_mode != RLE_OFF) && (anchor_k == 0) && (threshold == 0) && (edits_fname == NULL)) printf("Run-length: %s\n", rle_names[rle_mode]);
 
     getrusage(RUSAGE_SELF, &ru[0]);
 
@@ -421,7 +1707,48 @@ int main(int argc, char *argv[]) {
         init_page_faults();  // Initialize page fault counters
         double start = get_wall_time();
         copy_seq(i);
-        l = lcs_hirschberg();
+        skip = 0;
+        score_cells[0] = score_cells[1] = 0;
+        est = err = est_t = 0.0;
+        if (samples > 0) {
+            est = (sym_bytes == 4)   ? lcs_hirschberg_estimate<uint32_t>(&err)
+                  : (sym_bytes == 2) ? lcs_hirschberg_estimate<uint16_t>(&err)
+                                     : lcs_hirschberg_estimate<SYMBOL_TYPE>(&err);
+            est_t = get_wall_time() - start;
+            skip = (min_ratio <= 0.0) || (est + err < min_ratio);
+        }
+        if (skip)
+            l = -1;
+        else if (threshold > 0)
+            l = (sym_bytes == 4)   ? lcs_hirschberg_decide<uint32_t>(&frac)
+                : (sym_bytes == 2) ? lcs_hirschberg_decide<uint16_t>(&frac)
+                                   : lcs_hirschberg_decide<SYMBOL_TYPE>(&frac);
+        else if (edits_fname != NULL)
+            l = lcs_hirschberg_edits(prn);
+        else if (interleave > 1) {
+            if ((i % interleave) == 0) lcs_hirschberg_interleave(i, min(interleave, r - i));
+            l = zps[i];
+        } else {
+            if (align_fp != NULL) align_begin(i);
+            if (anchor_k > 0)
+                l = lcs_hirschberg_anchor();
+            else
+                l = (sym_bytes == 4)   ? lcs_hirschberg<uint32_t>()
+                    : (sym_bytes == 2) ? lcs_hirschberg<uint16_t>()
+                                       : lcs_hirschberg<SYMBOL_TYPE>();
+            if (worker_failed) {
+                printf("\nError: memory allocation failed!\n\n");
+                align_close();
+                free_memory(r);
+                tok_free();
+                return 0;
+            }
+            if (align_fp != NULL) align_end(nx, ny);
+            if (par_verify && (anchor_k == 0) && !rle_used)
+                par_diff = (sym_bytes == 4)   ? lcs_hirschberg_verify<uint32_t>(l)
+                           : (sym_bytes == 2) ? lcs_hirschberg_verify<uint16_t>(l)
+                                              : lcs_hirschberg_verify<SYMBOL_TYPE>(l);
+        }
         zps[i] = l;
         double end = get_wall_time();
         getrusage(RUSAGE_SELF, &ru[i + 1]);
@@ -441,6 +1768,68 @@ int main(int argc, char *argv[]) {
         printf("  System time:             %.4f seconds (%s)\n", run_st, conv_sec(run_st, str));
         printf("  Total time:              %.4f seconds (%s)\n", run_tt, conv_sec(run_tt, str));
 
+        if (samples > 0) {
+            print_estimate(est, err, samples, nx, ny, est_t);
+            if (skip && (min_ratio > 0.0)) printf("  Exact run:               skipped (below cutoff)\n");
+        }
+        if ((threshold > 0) && !skip) print_decision(threshold, answer, frac);
+        if ((anchor_k > 0) && (threshold == 0) && !skip) {
+            printf("Anchors:\n");
+            printf("  Fragments:               %lld (k = %d)\n", a_frag, anchor_k);
+            printf("  Chained:                 %lld, covering %lld symbols\n", a_chain, a_cover);
+            printf("  Gap subproblems:         %lld, %.2f%% of the matrix\n", a_gaps, 100.0 * a_cells);
+            if (a_exact < 0)
+                printf("  Exact check:             skipped (--anchor-fast)\n");
+            else if (a_exact)
+                printf("  Exact check:             chain optimal (band %lld..%lld, %.2f%% of the matrix)\n", a_lo,
+                       a_hi, 100.0 * a_check);
+            else
+                printf("  Exact check:             chain suboptimal, full ALG_C used\n");
+        }
+
+        if ((edits_fname != NULL) && (threshold == 0) && !skip) {
+            printf("Edits:\n");
+            printf("  Applied:                 %d, final m = %lld\n", n_edits, nx);
+            printf("  Rows recomputed:         %lld (%.2f full passes)\n", ck_rows,
+                   (double)ck_rows / (max(nxs[i], (INDEX_TYPE)1)));
+        }
+        if ((interleave > 1) && ((i % interleave) == 0)) {
+            printf("Interleaved:\n");
+            printf("  Batch:                   runs %d..%d, timed as this run\n", i + 1, min(i + interleave, r));
+            printf("  Steps:                   %lld\n", ilv_steps);
+        }
+        if (par_on && (anchor_k == 0) && (threshold == 0) && (edits_fname == NULL) && !skip) {
+            printf("Parallel:\n");
+            if (rle_used)
+                printf("  Tasks:                   none (run-length ALG_C is sequential)\n");
+            else
+                printf("  Tasks:                   %d split halves on their own threads\n", (int)par_tasks);
+            if (par_verify && !rle_used) {
+                if (par_diff == 0)
+                    printf("  Deterministic:           Z identical to the sequential run (%d symbols)\n", l);
+                else
+                    printf("  Deterministic:           Z differs from the sequential run at %d\n", par_diff);
+            }
+        }
+        // with --rle=auto|on, including which engine auto picked
+        if ((rle_mode != RLE_OFF) && (anchor_k == 0) && (threshold == 0) && (edits_fname == NULL) && (interleave <= 1) &&
+            !skip) {
+            printf("Run-length:\n");
+            printf("  Runs:                    X %lld (%.2f per run), Y %lld (%.2f per run)\n", rle_x,
+                   (double)nx / (max(rle_x, (INDEX_TYPE)1)), rle_y, (double)ny / (max(rle_y, (INDEX_TYPE)1)));
+            printf("  Engine:                  %s\n", rle_used ? "run-length ALG_C" : "plain ALG_C");
+        }
+
+        // only when 16-bit rows ran or --score-width was given, so default int runs keep their output
+        if ((score_cells[0] + score_cells[1] > 0) && ((score_cells[1] > 0) || score_forced)) {
+            printf("Scores:\n");
+            printf("  Rows:                    %d-bit, %.1f MB peak resident\n", 8 * score_bytes,
+                   ru[i + 1].ru_maxrss / 1024.0);
+            printf("  Cells at 16 / 32 bits:   %lld / %lld\n", (long long)score_cells[1], (long long)score_cells[0]);
+            printf("  Cell throughput:         %.1f M cells/s\n",
+                   (score_cells[0] + score_cells[1]) / (max(end - start, 1e-9)) / 1e6);
+        }
+
         print_proc_io();
         print_disk_io();  // Show disk I/O activity difference
         print_mem_data();
@@ -454,7 +1843,9 @@ int main(int argc, char *argv[]) {
 
     print_final_results(zps[r - 1], ut, st, tt, r, str);
 
+    align_close();
     free_memory(r);
+    tok_free();
 
     return 0;
 }
\ No newline at end of file
@@ -3,7 +3,9 @@ Our cache-oblivious LCS algorithm from SODA'06.
 Last Update: Sep 04, 2006 ( Rezaul Alam Chowdhury, UT Austin )
 */
 
+#include <limits.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,6 +14,14 @@ Last Update: Sep 04, 2006 ( Rezaul Alam Chowdhury, UT Austin )
 #include <time.h>
 
 #include "../include/util.h"
+#include "../include/align.h"
+#include "../include/bitpack.h"
+#include "../include/spacebound.h"
+#include "../include/tokens.h"
+#include "../include/alphabet.h"
+#include "../include/liblcs.h"
+#include "../include/lcs_ctx.h"
+#include "../include/oblivious.h"
 
 #define DEFAULT_BASE 32
 
@@ -19,60 +29,149 @@ Last Update: Sep 04, 2006 ( Rezaul Alam Chowdhury, UT Austin )
 
 #define SYMBOL_TYPE char
 
-#define IDX(b, t) (MAX_N + b + t)
-#define max(a, b) ((a) > (b)) ? (a) : (b)
-#define min(a, b) ((a) < (b)) ? (a) : (b)
+INDEX_TYPE MAX_N;
+int BASE_N;
+int base_kernel;  // base_sizes slot of BASE_N
 
-#define BIDX(j, i) (((j) << LOG_BASE_N) + j + i)
+// the kernel state: with --tokens, X, Y and Z hold sym_bytes-wide token IDs, read as the score policy's sym type
+struct lcs_ctx ctx;
+int sym_bytes = sizeof(SYMBOL_TYPE);
 
-int MAX_N;
-int BASE_N;
-int LOG_BASE_N;
+char **XS;
+char **YS;
 
-SYMBOL_TYPE *X;
-SYMBOL_TYPE *Y;
-SYMBOL_TYPE *Z;
+INDEX_TYPE *nxs;
+INDEX_TYPE *nys;
 
-int nx, ny;
+struct snap_cache snaps;
+struct pack_stats packs;
 
-int xp, yp, zp;
+int threads = 1;
 
-char **XS;
-char **YS;
+int length_only;
+
+int threshold;
+INDEX_TYPE *rpos;
 
-int *nxs;
-int *nys;
+// rlen and blen hold score_bytes per entry, read as the score policy's val type
+int score_bytes = sizeof(int);
+int score_auto = 1;
+int score_forced;  // --score-width given
+int pack_forced;  // --pack given
+int decided, answer;
+long long cells_done, next_check;
 
-int *rlen;
-int *buf_rlen;
-int *buf_up;
-int *buf_left;
-int *buf_up_left;
+int samples;
+double min_ratio;
+double *ests;
 
-int *blen;
+int score_type;
+int W[MAX_ALPHABET_SIZE][MAX_ALPHABET_SIZE];
+const char *score_names[] = {"lcs", "edit", "weighted"};
 
 struct rusage *ru;
 int *zps;
 
 char alpha[MAX_ALPHABET_SIZE + 1];
+struct alpha_map amap;
 
 char *fname1;
 char *fname2;
 
+// --score: lcs_score and edit_score are in include/oblivious.h, weighted_score reads W here
+#define SCORE_LCS 0
+#define SCORE_EDIT 1
+#define SCORE_WEIGHTED 2
+
+#define SYM(c) ((unsigned char)(c))
+
+/* Weighted LCS: aligning x with y scores W[x][y], gaps score 0. */
+struct weighted_score {
+    typedef SYMBOL_TYPE sym;
+    typedef int val;
+    static inline int init(int k) { return 0; }
+    static inline int cell(int d, int u, int l, SYMBOL_TYPE x, SYMBOL_TYPE y) {
+        int g = (u > l) ? u : l;
+        d += W[SYM(x)][SYM(y)];
+        return (d > g) ? d : g;
+    }
+    static inline void step(int &v, int u, int l, SYMBOL_TYPE x, SYMBOL_TYPE y) { v = cell(v, u, l, x, y); }
+    static inline int diag(int v, int d, SYMBOL_TYPE x, SYMBOL_TYPE y) {
+        return (W[SYM(x)][SYM(y)] > 0) && (v == d + W[SYM(x)][SYM(y)]);
+    }
+    static inline int better(int a, int b) { return a > b; }
+};
+
+/*
+Substitution matrix in the usual NCBI layout: a header line of symbols,
+then one row per symbol starting with that symbol. '#' lines are comments.
+Pairs not listed keep the LCS default (1 on the diagonal, 0 elsewhere).
+*/
+int read_matrix(const char *fname) {
+    FILE *fp;
+    char line[4096], cols[MAX_ALPHABET_SIZE], *t;
+    int i, nc = 0, v;
+    unsigned char c;
+
+    if ((fp = fopen(fname, "r")) == NULL) return 0;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if ((line[0] == '#') || (line[strspn(line, " \t\r\n")] == 0)) continue;
+
+        if (nc == 0) {
+            for (t = strtok(line, " \t\r\n"); (t != NULL) && (nc < MAX_ALPHABET_SIZE); t = strtok(NULL, " \t\r\n"))
+                cols[nc++] = t[0];
+            continue;
+        }
+
+        t = strtok(line, " \t\r\n");
+        c = SYM(t[0]);
+        for (i = 0; (i < nc) && ((t = strtok(NULL, " \t\r\n")) != NULL); i++) {
+            v = atoi(t);
+            W[c][SYM(cols[i])] = v;
+        }
+    }
+    fclose(fp);
+
+    return nc > 0;
+}
+
+/* Kernel matches (right to left, i < 0 for a mismatch): spooled for the alignment file. */
+void spool_match(struct lcs_ctx *c, INDEX_TYPE i, INDEX_TYPE j) { align_spool(i, j); }
+
+/* The kernel context from the options; allocate_memory sets its buffers, copy_seq its pair. */
+void ctx_setup(void) {
+    ctx.a = lcs_sys;
+    ctx.base = BASE_N;
+    ctx.base_kernel = base_kernel;
+    ctx.match = (align_fp != NULL) ? spool_match : NULL;
+    ctx.alpha = &amap;
+    ctx.snap = (snaps.tab != NULL) ? &snaps : NULL;
+    ctx.pack = &packs;
+}
+
 void free_memory(int r) {
     int i;
 
-    if (Z != NULL) free(Z);
+    if (ctx.Z != NULL) free(ctx.Z);
+
+    if (ctx.rlen != NULL) free(ctx.rlen);
+    if (rpos != NULL) free(rpos);
 
-    if (rlen != NULL) free(rlen);
+    if (ests != NULL) free(ests);
 
-    if (buf_rlen != NULL) free(buf_rlen);
+    if (ctx.buf_up != NULL) free(ctx.buf_up);
+    if (ctx.buf_left != NULL) free(ctx.buf_left);
+    if (ctx.buf_up_left != NULL) free(ctx.buf_up_left);
 
-    if (buf_up != NULL) free(buf_up);
-    if (buf_left != NULL) free(buf_left);
-    if (buf_up_left != NULL) free(buf_up_left);
+    if (ctx.blen != NULL) free(ctx.blen);
+
+    if (snaps.tab != NULL) {
+        snap_clear(&snaps);
+        free(snaps.tab);
+    }
 
-    if (blen != NULL) free(blen);
+    lcs_unreserve(&ctx, &ctx.masks);
 
     if (XS != NULL) {
         for (i = 0; i < r; i++)
@@ -106,48 +205,62 @@ int myceil(double v) {
     return i;
 }
 
-int allocate_memory(int m, int n, int r, int b) {
-    int i, d, nn, mm;
+int allocate_memory(INDEX_TYPE m, INDEX_TYPE n, int r, int b) {
+    INDEX_TYPE mm;
+    int i;
+
+    // diagonals -n .. m, plus one on each side for the neighbour reads at the edges
+    ctx.diag0 = n + 1;
+    ctx.rlen = (int *)malloc((m + n + 3) * score_bytes);
+
+    if (threshold > 0) rpos = (INDEX_TYPE *)malloc((m + n + 3) * sizeof(INDEX_TYPE));
 
-    nn = 1;
+    if (samples > 0) ests = (double *)malloc(samples * sizeof(double));
 
-    while (nn < m) nn <<= 1;
+    if (!length_only) {
+        mm = min(m, n);
 
-    mm = min(m, n);
+        ctx.Z = (SYMBOL_TYPE *)malloc((mm + 2) * sym_bytes);
 
-    Z = (SYMBOL_TYPE *)malloc((mm + 2) * sizeof(SYMBOL_TYPE));
+        // a level's saves fit in the sides of its last part plus 2, which sum to under 3 (m + n) down the recursion
+        ctx.buf_up = (int *)malloc((3LL * (m + n) + 256) * sizeof(int));
+        ctx.buf_left = (int *)malloc((3LL * (m + n) + 256) * sizeof(int));
+        ctx.buf_up_left = (int *)malloc((3LL * (m + n) + 256) * sizeof(int));
 
-    rlen = (int *)malloc((2 * nn + 1) * sizeof(int));
+        ctx.blen = (int *)malloc((b + 1) * (b + 1) * score_bytes);
 
-    mm = n * ((int)ceil((m * 1.0) / n) - 1);
-    if (mm > 0) buf_rlen = (int *)malloc((mm) * sizeof(int));
+        if (snaps.budget > 0) {
+            double e = min((double)snaps.budget / ((2 * b + 1) * sizeof(int)), 1.5 * ((double)m / b) * ((double)n / b));
 
-    buf_up = (int *)malloc((3 * nn) * sizeof(int));
-    buf_left = (int *)malloc((3 * nn) * sizeof(int));
-    buf_up_left = (int *)malloc((3 * nn) * sizeof(int));
+            for (snaps.size = 16; snaps.size < 2 * e; snaps.size <<= 1)
+                ;
+            snaps.tab = (struct snap *)calloc(snaps.size, sizeof(struct snap));
+        }
+    }
 
     XS = (char **)malloc((r) * sizeof(char *));
     YS = (char **)malloc((r) * sizeof(char *));
 
-    nxs = (int *)malloc((r) * sizeof(int));
-    nys = (int *)malloc((r) * sizeof(int));
-
-    blen = (int *)malloc((b + 1) * (b + 1) * sizeof(int));
+    nxs = (INDEX_TYPE *)malloc((r) * sizeof(INDEX_TYPE));
+    nys = (INDEX_TYPE *)malloc((r) * sizeof(INDEX_TYPE));
 
     ru = (struct rusage *)malloc((r + 1) * sizeof(struct rusage));
     zps = (int *)malloc((r) * sizeof(int));
 
-    if ((Z == NULL) || (rlen == NULL) || ((mm > 0) && (buf_rlen == NULL)) || (buf_up == NULL) ||
-        (buf_left == NULL) || (buf_up_left == NULL) || (XS == NULL) || (YS == NULL) ||
-        (nxs == NULL) || (nys == NULL) || (blen == NULL) || (ru == NULL) || (zps == NULL)) {
+    if ((ctx.rlen == NULL) || ((threshold > 0) && (rpos == NULL)) || ((samples > 0) && (ests == NULL)) ||
+        (XS == NULL) || (YS == NULL) || (nxs == NULL) || (nys == NULL) ||
+        (ru == NULL) || (zps == NULL) ||
+        (!length_only && ((ctx.Z == NULL) || (ctx.buf_up == NULL) ||
+                          (ctx.buf_left == NULL) || (ctx.buf_up_left == NULL) || (ctx.blen == NULL) ||
+                          ((snaps.budget > 0) && (snaps.tab == NULL))))) {
         printf("\nError: memory allocation failed!\n\n");
         free_memory(r);
         return 0;
     }
 
     for (i = 0; i < r; i++) {
-        XS[i] = (char *)malloc((m + 2) * sizeof(char));
-        YS[i] = (char *)malloc((n + 2) * sizeof(char));
+        XS[i] = (char *)malloc((m + 2) * sym_bytes);
+        YS[i] = (char *)malloc((n + 2) * sym_bytes);
 
         if ((XS[i] == NULL) || (YS[i] == NULL)) {
             printf("\nError: memory allocation failed!\n\n");
@@ -156,6 +269,8 @@ int allocate_memory(int m, int n, int r, int b) {
         }
     }
 
+    ctx_setup();
+
     return 1;
 }
 
@@ -198,246 +313,485 @@ int read_data_sep(int r) {
     return 1;
 }
 
-int get_m_n_sep(int *m, int *n) {
+/*
+Codes the alphabet header, or without one the symbols of the r pairs, and
+selects the row kernel; 0 if a pair has a symbol outside the header.
+*/
+int code_alphabet(int r) {
+    INDEX_TYPE k;
+    int i;
+
+    alpha_reset(&amap);
+    alpha_derived = (alpha[0] == 0);
+    alpha_add(&amap, alpha, strlen(alpha));
+
+    for (i = 0; i < r; i++) {
+        if (alpha_derived) {
+            alpha_add(&amap, XS[i] + 1, nxs[i]);
+            alpha_add(&amap, YS[i] + 1, nys[i]);
+        } else if ((k = alpha_find(&amap, XS[i] + 1, nxs[i])) >= 0) {
+            printf("\nError: symbol '%c' at X[%lld] of pair %d is not in the alphabet %s!\n", XS[i][k + 1], k + 1,
+                   i + 1, alpha);
+            return 0;
+        } else if ((k = alpha_find(&amap, YS[i] + 1, nys[i])) >= 0) {
+            printf("\nError: symbol '%c' at Y[%lld] of pair %d is not in the alphabet %s!\n", YS[i][k + 1], k + 1,
+                   i + 1, alpha);
+            return 0;
+        }
+    }
+
+    alpha_select(&amap, alpha_mode);
+
+    return 1;
+}
+
+/* The token IDs of the two files into every pair, as symbols of sym_bytes. */
+void read_tokens(int r) {
+    int i;
+
+    for (i = 0; i < r; i++) {
+        if (sym_bytes == 4) {
+            tok_store<uint32_t>(XS[i], tok_x, tok_nx);
+            tok_store<uint32_t>(YS[i], tok_y, tok_ny);
+        } else if (sym_bytes == 2) {
+            tok_store<uint16_t>(XS[i], tok_x, tok_nx);
+            tok_store<uint16_t>(YS[i], tok_y, tok_ny);
+        } else {
+            tok_store<SYMBOL_TYPE>(XS[i], tok_x, tok_nx);
+            tok_store<SYMBOL_TYPE>(YS[i], tok_y, tok_ny);
+        }
+        nxs[i] = tok_nx;
+        nys[i] = tok_ny;
+    }
+}
+
+int get_m_n_sep(INDEX_TYPE *m, INDEX_TYPE *n) {
     FILE *fp;
 
     if ((fp = fopen(fname1, "r")) == NULL) return 0;
-    if (fscanf(fp, "%d", m) != 1) return 0;
+    if (fscanf(fp, "%lld", m) != 1) return 0;
     fclose(fp);
 
     if ((fp = fopen(fname2, "r")) == NULL) return 0;
-    if (fscanf(fp, "%d", n) != 1) return 0;
+    if (fscanf(fp, "%lld", n) != 1) return 0;
     fclose(fp);
 
     return 1;
 }
 
 void copy_seq(int j) {
-    int i;
+    ctx.nx = nxs[j];
+    ctx.ny = nys[j];
 
-    nx = nxs[j];
-    ny = nys[j];
+    ctx.X = XS[j] + sym_bytes;
+    ctx.Y = YS[j] + sym_bytes;
+}
 
-    X = XS[j];
-    Y = YS[j];
+/*
+Decision mode: rpos[l] is the row of the last computed cell on diagonal l.
+The computed region is always closed under DP predecessors, so every path
+to (nx, ny) leaves it through one of these cells, and
+max(rlen[l] + min(nx - i, ny - j)) bounds the LCS from above.
+*/
+void note_front(INDEX_TYPE l, INDEX_TYPE lt, INDEX_TYPE i) {
+    for (; l <= lt; l += 2, i++) {
+        rpos[l] = i;
+        cells_done++;
+    }
 }
 
-void lcs_inverted_triangle(int bi, int bj, int n);
+void lcs_decide(struct lcs_ctx *c) {
+    INDEX_TYPE d, i, j, v, best = 0, bound = 0;
 
-void lcs_straight_triangle(int bi, int bj, int n) {
-    int i, j, k, l, lt, nn;
+    for (d = -c->ny; d <= c->nx; d++) {
+        v = c->rlen[IDX(0, d)];
+        i = rpos[IDX(0, d)];
+        j = i - d;
+        if (v > best) best = v;
+        v += (min(c->nx - i, c->ny - j));
+        if (v > bound) bound = v;
+    }
 
-    if (n <= BASE_N) {
+    if (best >= threshold) {
+        decided = 1;
+        answer = 1;
+    } else if (bound < threshold) {
+        decided = 1;
+        answer = 0;
+    }
+
+    next_check = cells_done + 8LL * (c->nx + c->ny + 1);
+}
+
+template <class S>
+void lcs_inverted_triangle(struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE n);
+
+template <class S>
+void lcs_straight_triangle(struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE n) {
+    typename S::val *R = (typename S::val *)c->rlen;
+    INDEX_TYPE i, j, k, l, lt, nn;
+    const typename S::sym *x = (const typename S::sym *)c->X, *y = (const typename S::sym *)c->Y;
+
+    if (decided) return;
+
+    if (n <= c->base) {
         for (k = 0; k < n; k++) {
-            i = min(bi + k, xp);
+            i = min(bi + k, c->xp);
             j = bj + (bi + k - i);
             lt = IDX(0, i - j);
-            j = min(bj + k, yp);
+            j = min(bj + k, c->yp);
             i = bi + (bj + k - j);
-            for (l = IDX(0, i - j); l <= lt; l += 2, i++, j--) {
-                if (X[i] == Y[j])
-                    rlen[l] = rlen[l] + 1;
-                else
-                    rlen[l] = max(rlen[l - 1], rlen[l + 1]);
-            }
+            if (rpos != NULL) note_front(IDX(0, i - j), lt, i);
+            for (l = IDX(0, i - j); l <= lt; l += 2, i++, j--)
+                S::step(R[l], R[l - 1], R[l + 1], x[i - 1], y[j - 1]);
         }
+
+        if ((rpos != NULL) && (cells_done >= next_check)) lcs_decide(c);
     } else {
         nn = n >> 1;
 
-        lcs_straight_triangle(bi, bj, nn);
-        lcs_inverted_triangle(bi, bj, nn);
-        if (xp >= bi + nn) lcs_straight_triangle(bi + nn, bj, nn);
-        if (yp >= bj + nn) lcs_straight_triangle(bi, bj + nn, nn);
+        lcs_straight_triangle<S>(c, bi, bj, nn);
+        lcs_inverted_triangle<S>(c, bi, bj, nn);
+        if (c->xp >= bi + nn) lcs_straight_triangle<S>(c, bi + nn, bj, nn);
+        if (c->yp >= bj + nn) lcs_straight_triangle<S>(c, bi, bj + nn, nn);
     }
 }
 
-void lcs_inverted_triangle(int bi, int bj, int n) {
-    int i, j, k, l, lt, nn;
+template <class S>
+void lcs_inverted_triangle(struct lcs_ctx *c, INDEX_TYPE bi, INDEX_TYPE bj, INDEX_TYPE n) {
+    typename S::val *R = (typename S::val *)c->rlen;
+    INDEX_TYPE i, j, k, l, lt, nn;
+    const typename S::sym *x = (const typename S::sym *)c->X, *y = (const typename S::sym *)c->Y;
+
+    if (decided) return;
 
-    if (n <= BASE_N) {
+    if (n <= c->base) {
         for (k = n - 2; k >= 0; k--) {
-            i = min(bi - 1 + n, xp);
+            i = min(bi - 1 + n, c->xp);
             j = bj - 1 + n - k + ((bi - 1 + n) - i);
             lt = IDX(0, i - j);
-            j = min(bj - 1 + n, yp);
+            j = min(bj - 1 + n, c->yp);
             i = bi - 1 + n - k + ((bj - 1 + n) - j);
-            for (l = IDX(0, i - j); l <= lt; l += 2, i++, j--) {
-                if (X[i] == Y[j])
-                    rlen[l] = rlen[l] + 1;
-                else
-                    rlen[l] = max(rlen[l - 1], rlen[l + 1]);
-            }
+            if (rpos != NULL) note_front(IDX(0, i - j), lt, i);
+            for (l = IDX(0, i - j); l <= lt; l += 2, i++, j--)
+                S::step(R[l], R[l - 1], R[l + 1], x[i - 1], y[j - 1]);
         }
+
+        if ((rpos != NULL) && (cells_done >= next_check)) lcs_decide(c);
     } else {
         nn = n >> 1;
 
-        if (xp >= bi + nn) lcs_inverted_triangle(bi + nn, bj, nn);
-        if (yp >= bj + nn) lcs_inverted_triangle(bi, bj + nn, nn);
-        if ((xp >= bi + nn) && (yp >= bj + nn)) {
-            lcs_straight_triangle(nn + bi, nn + bj, nn);
-            lcs_inverted_triangle(nn + bi, nn + bj, nn);
+        if (c->xp >= bi + nn) lcs_inverted_triangle<S>(c, bi + nn, bj, nn);
+        if (c->yp >= bj + nn) lcs_inverted_triangle<S>(c, bi, bj + nn, nn);
+        if ((c->xp >= bi + nn) && (c->yp >= bj + nn)) {
+            lcs_straight_triangle<S>(c, nn + bi, nn + bj, nn);
+            lcs_inverted_triangle<S>(c, nn + bi, nn + bj, nn);
         }
     }
 }
 
-void rec_LCS(int bi, int bj, int n, int f) {
-    int i, j, k, mm, nn, b = bi - bj, sv;
+/*
+LCS of the window X[px + 1 .. px + wx] x Y[py + 1 .. py + wy], using the same
+triangle sweep on the window's diagonals of rlen.
+*/
+template <class T>
+int lcs_window(struct lcs_ctx *c, INDEX_TYPE px, INDEX_TYPE py, INDEX_TYPE wx, INDEX_TYPE wy) {
+    INDEX_TYPE d, n = 1;
+    int l, *LL;
+
+    // a coded alphabet takes the window in match-mask rows
+    if ((c->alpha->kernel > 0) && ((LL = (int *)malloc((wy + 1) * sizeof(int))) != NULL)) {
+        l = lcs_rows(c, wx, wy, (const T *)c->X + px, (const T *)c->Y + py, LL) ? LL[wy] : -1;
+        free(LL);
+        if (l >= 0) return l;
+    }
 
-    if (n <= BASE_N) {
-        mm = xp - bi + 1;
-        nn = yp - bj + 1;
+    while ((n < wx) || (n < wy)) n <<= 1;
 
-        for (k = 0; k <= mm; k++) blen[BIDX(0, k)] = rlen[IDX(b, k)];
+    for (d = px - py - wy; d <= px - py + wx; d++) c->rlen[IDX(0, d)] = 0;
 
-        for (k = 0; k <= nn; k++) blen[BIDX(k, 0)] = rlen[IDX(b, -k)];
+    c->xp = px + wx;
+    c->yp = py + wy;
 
-        for (j = 1; j <= nn; j++)
-            for (i = 1, k = BIDX(j, 1); i <= mm; i++, k++) {
-                if (X[bi + i - 1] == Y[bj + j - 1])
-                    blen[k] = blen[k - BASE_N - 2] + 1;
-                else
-                    blen[k] = max(blen[k - BASE_N - 1], blen[k - 1]);
-            }
+    lcs_straight_triangle<lcs_score<T, int> >(c, px + 1, py + 1, n);
+    lcs_inverted_triangle<lcs_score<T, int> >(c, px + 1, py + 1, n);
 
-        while ((mm > 0) && (nn > 0)) {
-            if (X[bi + mm - 1] == Y[bj + nn - 1]) {
-                Z[zp++] = X[bi + mm - 1];
-                mm--;
-                nn--;
-            } else if (blen[BIDX(nn - 1, mm)] > blen[BIDX(nn, mm - 1)])
-                nn--;
-            else
-                mm--;
-        }
+    return c->rlen[IDX(0, c->xp - c->yp)];
+}
 
-        xp = mm + bi - 1;
-        yp = nn + bj - 1;
-    } else {
-        nn = n >> 1;
+/*
+Pre-triage estimate of LCS / min(nx, ny) from stratified window pairs along
+the main diagonal, extrapolated to the pair (see util.h). Windows keep the
+aspect ratio of the pair.
+*/
+template <class T>
+double lcs_oblivious_estimate(int r, double *err) {
+    INDEX_TYPE px, py, wx, wy, sx, sy, *sv = rpos;
+    int k;
+    double t, mean, f, rs, rl;
+
+    copy_seq(r);
+
+    estimate_sides(ctx.nx, ctx.ny, ESTIMATE_WINDOW, &wx, &wy);
+    estimate_sides(ctx.nx, ctx.ny, ESTIMATE_INNER, &sx, &sy);
+    f = estimate_factor(min(sx, sy), min(wx, wy), min(ctx.nx, ctx.ny));
+
+    rpos = NULL;
+
+    for (k = 0; k < samples; k++) {
+        t = (k + estimate_rand()) / samples;
+        px = (INDEX_TYPE)(t * (ctx.nx - wx));
+        py = (INDEX_TYPE)(t * (ctx.ny - wy));
+        rl = lcs_window<T>(&ctx, px, py, wx, wy) / (double)(min(wx, wy));
+        rs = lcs_window<T>(&ctx, px + (wx - sx) / 2, py + (wy - sy) / 2, sx, sy) / (double)(min(sx, sy));
+        ests[k] = estimate_sample(rs, rl, f);
+    }
 
-        if ((xp >= bi + nn) || (yp >= bj + nn)) {
-            sv = 1;
+    rpos = sv;
 
-            for (k = -nn; k <= nn; k++) buf_up_left[f + k + nn] = rlen[IDX(b, k)];
+    summarize_samples(ests, samples, &mean, err);
 
-            lcs_straight_triangle(bi, bj, nn);
-            lcs_inverted_triangle(bi, bj, nn);
-        } else
-            sv = 0;
+    return mean;
+}
 
-        if ((xp >= bi + nn) && (yp >= bj + nn)) {
-            for (k = -nn; k <= nn; k++) buf_left[f + k + nn] = rlen[IDX(b - nn, k)];
+template <class S>
+void lcs_oblivious(int r) {
+    copy_seq(r);
+    rec_align<S>(&ctx);
+}
 
-            lcs_straight_triangle(bi, bj + nn, nn);
-            lcs_inverted_triangle(bi, bj + nn, nn);
+template <class S>
+int lcs_oblivious_length(int r) {
+    copy_seq(r);
+    return rec_length<S>(&ctx);
+}
 
-            for (k = -nn; k <= nn; k++) buf_up[f + k + nn] = rlen[IDX(b + nn, k)];
+/*
+Decision mode: answers LCS >= threshold with the length-only sweep, stopping
+as soon as a computed cell reaches the threshold or the upper bound along
+the current front drops below it.
+*/
+template <class T>
+int lcs_oblivious_decide(int r, INDEX_TYPE n, double *frac) {
+    struct lcs_ctx *c = &ctx;
+    INDEX_TYPE j;
 
-            lcs_straight_triangle(bi + nn, bj, nn);
-            lcs_inverted_triangle(bi + nn, bj, nn);
+    copy_seq(r);
 
-            rec_LCS(bi + nn, bj + nn, nn, f + n + 1);
+    for (j = -c->ny; j <= c->nx; j++) {
+        c->rlen[IDX(0, j)] = 0;
+        rpos[IDX(0, j)] = max(j, 0);
+    }
 
-            if (xp >= bi + nn) {
-                for (k = -nn; k <= nn; k++) rlen[IDX(b + nn, k)] = buf_up[f + k + nn];
-            } else if (yp >= bj + nn) {
-                for (k = -nn; k <= nn; k++) rlen[IDX(b - nn, k)] = buf_left[f + k + nn];
-            }
-        }
+    c->xp = c->nx;
+    c->yp = c->ny;
 
-        if (xp >= bi + nn)
-            rec_LCS(bi + nn, bj, nn, f + n + 1);
-        else if (yp >= bj + nn)
-            rec_LCS(bi, bj + nn, nn, f + n + 1);
+    decided = 0;
+    cells_done = 0;
+    lcs_decide(c);
 
-        if ((xp >= bi) && (yp >= bj)) {
-            if (sv) {
-                for (k = -nn; k <= nn; k++) rlen[IDX(b, k)] = buf_up_left[f + k + nn];
-            }
+    lcs_straight_triangle<lcs_score<T, int> >(c, 1, 1, n);
+    lcs_inverted_triangle<lcs_score<T, int> >(c, 1, 1, n);
 
-            rec_LCS(bi, bj, nn, f + n + 1);
-        }
+    if (!decided) {
+        answer = (c->rlen[IDX(0, c->nx - c->ny)] >= threshold);
+        *frac = 1.0;
+        return c->rlen[IDX(0, c->nx - c->ny)];
     }
-}
 
-void lcs_oblivious(int r, int n) {
-    int i, j, k, l, t;
+    decided = 0;
+    *frac = ((c->nx > 0) && (c->ny > 0)) ? cells_done / ((double)c->nx * c->ny) : 0.0;
 
-    nx = nxs[r];
-    ny = nys[r];
+    return -1;
+}
 
-    X = XS[r];
-    Y = YS[r];
+/* lcs_oblivious_length / lcs_oblivious under score P, on symbols of sym_bytes and scores of score_bytes. */
+template <template <class, class> class P, class T>
+int length_by_score(int r) {
+    return (score_bytes == sizeof(uint16_t)) ? lcs_oblivious_length<P<T, uint16_t> >(r)
+                                             : lcs_oblivious_length<P<T, int> >(r);
+}
 
-    for (j = -ny; j < nx; j++) rlen[IDX(0, j)] = 0;
+template <template <class, class> class P>
+int length_by_width(int r) {
+    return (sym_bytes == 4)   ? length_by_score<P, uint32_t>(r)
+           : (sym_bytes == 2) ? length_by_score<P, uint16_t>(r)
+                              : length_by_score<P, SYMBOL_TYPE>(r);
+}
 
-    xp = nx;
-    yp = ny;
-    zp = 0;
+template <template <class, class> class P, class T>
+void oblivious_by_score(int r) {
+    if (score_bytes == sizeof(uint16_t))
+        lcs_oblivious<P<T, uint16_t> >(r);
+    else
+        lcs_oblivious<P<T, int> >(r);
+}
 
-    rec_LCS(1, 1, n, 0);
+template <template <class, class> class P>
+void oblivious_by_width(int r) {
+    if (sym_bytes == 4)
+        oblivious_by_score<P, uint32_t>(r);
+    else if (sym_bytes == 2)
+        oblivious_by_score<P, uint16_t>(r);
+    else
+        oblivious_by_score<P, SYMBOL_TYPE>(r);
 }
 
 int find_rec_LCS(void) {
     int i, j;
     SYMBOL_TYPE s;
 
-    Z[zp] = 0;
+    ctx.Z[ctx.zp] = 0;
 
-    for (i = 0, j = zp - 1; i < j; i++, j--) {
-        s = Z[i];
-        Z[i] = Z[j];
-        Z[j] = s;
+    for (i = 0, j = ctx.zp - 1; i < j; i++, j--) {
+        s = ctx.Z[i];
+        ctx.Z[i] = ctx.Z[j];
+        ctx.Z[j] = s;
     }
 
-    printf("LCS Length = %d\n", zp);
+    printf("LCS Length = %d\n", ctx.zp);
     printf("LCS = ");
-    for (i = 0; i < zp; i++) printf("%c", Z[i]);
+    for (i = 0; i < ctx.zp; i++) printf("%c", ctx.Z[i]);
     printf("\n\n");
 
-    return zp;
+    return ctx.zp;
 }
 
 void verify(void) {
-    int i, j;
+    INDEX_TYPE i, j;
 
-    for (i = j = 1; j <= zp; j++, i++) {
-        while ((i <= nx) && (Z[j - 1] != X[i])) i++;
-        if (i > nx) break;
+    for (i = j = 1; j <= ctx.zp; j++, i++) {
+        while ((i <= ctx.nx) && (ctx.Z[j - 1] != ctx.X[i - 1])) i++;
+        if (i > ctx.nx) break;
     }
 
-    if (j == zp + 1)
+    if (j == ctx.zp + 1)
         printf("Found in X!!!\n\n");
     else
         printf("Not Found in X!!!\n\n");
 
-    for (i = j = 1; j <= zp; j++, i++) {
-        while ((i <= nx) && (Z[j - 1] != Y[i])) i++;
-        if (i > ny) break;
+    for (i = j = 1; j <= ctx.zp; j++, i++) {
+        while ((i <= ctx.nx) && (ctx.Z[j - 1] != ctx.Y[i - 1])) i++;
+        if (i > ctx.ny) break;
     }
 
-    if (j == zp + 1)
+    if (j == ctx.zp + 1)
         printf("Found in Y!!!\n\n");
     else
         printf("Not Found in Y!!!\n\n");
 }
 
 int main(int argc, char *argv[]) {
-    int i, l, m, n, nn, r, b, prn;
-    double ut, st, tt;
+    INDEX_TYPE m, n;
+    int i, l, r, b, prn, skip;
+    double ut, st, tt, frac, est, err, est_t;
     char str[50];
 
     printf(
         "=====================================================================================\n");
     printf("Program: %s\n", argv[0]);
 
+    // the LCS default of --score=weighted, which --matrix entries (zeros included) override
+    for (i = 0; i < MAX_ALPHABET_SIZE; i++) W[i][i] = 1;
+
+    for (i = l = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--length-only") == 0)
+            length_only = 1;
+        else if (strncmp(argv[i], "--threshold=", 12) == 0) {
+            threshold = atoi(argv[i] + 12);
+            if (threshold <= 0) threshold = 1;
+            length_only = 1;
+        } else if ((strncmp(argv[i], "--align=", 8) == 0) || (strncmp(argv[i], "--cigar=", 8) == 0)) {
+            if (!align_open(argv[i] + 8, argv[i][2] == 'c') || !align_spool_begin()) {
+                printf("\nError: cannot open alignment file %s!\n", argv[i] + 8);
+                return 0;
+            }
+        } else if (strncmp(argv[i], "--score=", 8) == 0) {
+            for (score_type = SCORE_WEIGHTED; score_type >= 0; score_type--)
+                if (strcmp(argv[i] + 8, score_names[score_type]) == 0) break;
+            if (score_type < 0) {
+                printf("\nError: unknown score %s!\n", argv[i] + 8);
+                return 0;
+            }
+        } else if (strncmp(argv[i], "--matrix=", 9) == 0) {
+            if (!read_matrix(argv[i] + 9)) {
+                printf("\nError: cannot read substitution matrix %s!\n", argv[i] + 9);
+                return 0;
+            }
+            score_type = SCORE_WEIGHTED;
+        } else if ((strcmp(argv[i], "--pack=on") == 0) || (strcmp(argv[i], "--pack=off") == 0)) {
+            pack_on = (argv[i][8] == 'n');
+            pack_forced = 1;
+        } else if (strncmp(argv[i], "--cache-mb=", 11) == 0) {
+            snaps.budget = atoll(argv[i] + 11) * 1024 * 1024;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--sched=", 8) == 0) {
+            for (sb_mode = SB_GREEDY; sb_mode >= 0; sb_mode--)
+                if (strcmp(argv[i] + 8, sb_names[sb_mode]) == 0) break;
+            if (sb_mode < 0) {
+                printf("\nError: unknown scheduler %s!\n", argv[i] + 8);
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--estimate") == 0) {
+            if (samples == 0) samples = DEFAULT_SAMPLES;
+            length_only = 1;
+        } else if (strncmp(argv[i], "--samples=", 10) == 0) {
+            samples = atoi(argv[i] + 10);
+            if (samples <= 0) samples = DEFAULT_SAMPLES;
+        } else if (strncmp(argv[i], "--score-width=", 14) == 0) {
+            if ((strcmp(argv[i] + 14, "auto") != 0) && (strcmp(argv[i] + 14, "32") != 0)) {
+                printf("\nError: unknown score width %s!\n", argv[i] + 14);
+                return 0;
+            }
+            score_auto = (argv[i][14] == 'a');
+            score_forced = 1;
+        } else if (strncmp(argv[i], "--alphabet=", 11) == 0) {
+            for (alpha_mode = ALPHA_OFF; alpha_mode >= 0; alpha_mode--)
+                if (strcmp(argv[i] + 11, alpha_names[alpha_mode]) == 0) break;
+            if (alpha_mode < 0) {
+                printf("\nError: unknown alphabet mode %s!\n", argv[i] + 11);
+                return 0;
+            }
+        } else if (strncmp(argv[i], "--tokens=", 9) == 0) {
+            for (tok_mode = TOK_WORDS; tok_mode > 0; tok_mode--)
+                if (strcmp(argv[i] + 9, tok_names[tok_mode]) == 0) break;
+            if (tok_mode == TOK_OFF) {
+                printf("\nError: unknown token mode %s!\n", argv[i] + 9);
+                return 0;
+            }
+        } else if (strncmp(argv[i], "--min-ratio=", 12) == 0) {
+            min_ratio = atof(argv[i] + 12);
+            if (samples == 0) samples = DEFAULT_SAMPLES;
+        } else
+            argv[l++] = argv[i];
+    }
+    argc = l;
+
     if (argc < 3) {
         printf("\nError: not enough arguments!\n");
         printf("Specify: n ( = length of sequence ) and r ( = number of runs ).\n\n");
+        printf("Options: --length-only ( = report the LCS length without reconstructing it ),\n");
+        printf("         --threshold=k ( = only decide whether LCS >= k, stopping early ),\n");
+        printf("         --estimate ( = sampled LCS ratio estimate only ), --samples=s,\n");
+        printf("         --min-ratio=q ( = skip pairs whose estimated ratio is clearly below q ),\n");
+        printf("         --align=file / --cigar=file ( = stream match pairs / edit script ),\n");
+        printf("         --score=lcs|edit|weighted, --matrix=file ( = substitution scores ),\n");
+        printf("         --tokens=lines|words ( = -1 file1 file2 r: LCS / edit distance of the files'\n");
+        printf("         lines / words ),\n");
+        printf("         --cache-mb=MB ( = keep quadrant boundaries for the traceback, up to MB ),\n");
+        printf("         --pack=on|off ( = bit-packed boundary snapshots; default on ),\n");
+        printf("         --score-width=auto|32 ( = 16-bit scores where every score fits them; default auto ),\n");
+        printf("         --alphabet=auto|off ( = match-mask estimate windows for up to %d symbols;\n",
+               ALPHA_MAX_KERNEL);
+        printf("         default auto ),\n");
+        printf("         --threads=t ( = sweep sibling triangles on t cores; 0 = all ),\n");
+        printf("         --sched=space|greedy ( = fork only while both halves fit the shared cache,\n");
+        printf("         or always; default space ).\n\n");
         return 0;
     }
 
-    n = atoi(argv[1]);
+    n = atoll(argv[1]);
     if (n == -1) {
         fname1 = argv[2];
         fname2 = argv[3];
@@ -448,10 +802,19 @@ int main(int argc, char *argv[]) {
     m = n;
 
     if (n == 0) {
-        if (scanf("%d %d\n\n", &m, &n) != 2) {
+        if (scanf("%lld %lld\n\n", &m, &n) != 2) {
             printf("\nError: cannot read sequence lengths!\n");
             return 0;
         }
+    } else if ((n == -1) && (tok_mode != TOK_OFF)) {
+        if (!tok_read(fname1, fname2)) {
+            printf("\nError: cannot read tokens from %s and %s!\n", fname1, fname2);
+            tok_free();
+            return 0;
+        }
+        m = tok_nx;
+        n = tok_ny;
+        sym_bytes = tok_width();
     } else if (n == -1) {
         if (!get_m_n_sep(&m, &n)) {
             printf("\nError: cannot read sequence lengths!\n");
@@ -459,13 +822,30 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    if (m < n) {
-        printf("\nError: m < n!\n");
+    // LCS and weighted scores grow with the shorter side, edit distances with the longer one
+    if (((score_type == SCORE_EDIT) ? (max(m, n)) : (min(m, n))) > INT_MAX) {
+        printf("\nError: a score over more than %d symbols does not fit the int scores!\n", INT_MAX);
         return 0;
     }
 
+    if ((tok_mode != TOK_OFF) && ((b == 0) || (score_type == SCORE_WEIGHTED))) {
+        printf("\nError: --tokens reads two text files ( -1 file1 file2 r ) with --score=lcs or edit!\n");
+        return 0;
+    }
+
+    if ((score_type != SCORE_LCS) && ((threshold > 0) || (samples > 0))) {
+        printf("\nError: --threshold, --estimate and --min-ratio need --score=lcs!\n");
+        return 0;
+    }
+
+    if (score_type == SCORE_EDIT)
+        SCORE_NAME = "Edit distance";
+    else if (score_type == SCORE_WEIGHTED)
+        SCORE_NAME = "Weighted LCS score";
+
+    // side of the triangle recursion in decision mode; the other modes recurse on m x n itself
     MAX_N = 1;
-    while (MAX_N < m) MAX_N <<= 1;
+    while ((MAX_N < m) || (MAX_N < n)) MAX_N <<= 1;
 
     if (argc > b + 3) {
         BASE_N = atoi(argv[b + 3]);
@@ -473,18 +853,24 @@ int main(int argc, char *argv[]) {
     } else
         BASE_N = DEFAULT_BASE;
 
-    l = BASE_N;
-    LOG_BASE_N = 0;
-    while (l > 1) {
-        l >>= 1;
-        LOG_BASE_N++;
-    }
+    base_kernel = base_slot(BASE_N);
 
     if (argc > b + 4)
         prn = atoi(argv[b + 4]);
     else
         prn = 0;
 
+    if ((threads != 1) && (threshold == 0) && !sb_init(threads)) {
+        printf("\nError: cannot read the cores of this process!\n");
+        return 0;
+    }
+
+    // LCS scores stay below min(m, n) + 1, edit distances below max(m, n) + 1; the decision and estimate sweeps keep int
+    if (score_auto && (threshold == 0) && (samples == 0) &&
+        (((score_type == SCORE_LCS) && ((min(m, n)) < SCORE16_LIMIT)) ||
+         ((score_type == SCORE_EDIT) && ((max(m, n)) < SCORE16_LIMIT))))
+        score_bytes = sizeof(uint16_t);
+
     if (!allocate_memory(m, n, r, BASE_N)) return 0;
 
     if (b == 0) {
@@ -493,7 +879,9 @@ int main(int argc, char *argv[]) {
             free_memory(r);
             return 0;
         }
-    } else {
+    } else if (tok_mode != TOK_OFF)
+        read_tokens(r);
+    else {
         if (!read_data_sep(r)) {
             printf("\nError: failed to read data!\n\n");
             free_memory(r);
@@ -501,8 +889,36 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    printf("m = %d, n = %d\n", m, n);
-    printf("Runs = %d, base case = %d\n", r, BASE_N);
+    if ((tok_mode == TOK_OFF) && !code_alphabet(r)) {
+        free_memory(r);
+        return 0;
+    }
+
+    printf("m = %lld, n = %lld\n", m, n);
+    printf("Runs = %d, base case = %d (%s kernel)\n", r, BASE_N, base_kernel ? "specialized" : "generic");
+    if (tok_mode != TOK_OFF)
+        printf("Tokens: %s, %u distinct, %d-bit symbols\n", tok_names[tok_mode], tok_distinct, 8 * sym_bytes);
+    else if ((samples > 0) && (amap.kernel > 0))
+        printf("Alphabet: %d symbols (%s), %d-code match-mask estimate windows\n", amap.size,
+               alpha_derived ? "derived" : "header", alpha_sizes[amap.kernel]);
+    else
+        printf("Alphabet: %d symbols (%s)\n", amap.size, alpha_derived ? "derived" : "header");
+    if (score_type != SCORE_LCS) printf("Score: %s\n", score_names[score_type]);
+    if ((samples > 0) && (min_ratio <= 0.0))
+        printf("Mode: estimate (%d samples)\n", samples);
+    else if (threshold > 0)
+        printf("Mode: decide LCS >= %d\n", threshold);
+    else if (length_only)
+        printf("Mode: length only\n");
+    if (min_ratio > 0.0) printf("Pre-pass: skip if estimated ratio < %.4f\n", min_ratio);
+    if ((align_fp != NULL) && length_only) printf("Alignment: not written in length-only modes\n");
+    if ((snaps.tab != NULL) && !length_only) printf("Snapshot cache: %lld MB\n", snaps.budget >> 20);
+    if (sb_ncpu > 1) {
+        printf("Scheduler: %s, %d cores", sb_names[sb_mode], sb_ncpu);
+        for (l = 0; l < sb_levels; l++)
+            printf("%s L%d %lld KB", (l == 0) ? ";" : ",", sb_level[l], sb_size[l] >> 10);
+        printf("\n");
+    }
 
     getrusage(RUSAGE_SELF, &ru[0]);
 
@@ -510,8 +926,46 @@ int main(int argc, char *argv[]) {
         init_disk_io();  // Initialize disk I/O counters
         init_page_faults();  // Initialize page fault counters
         double start = get_wall_time();
-        lcs_oblivious(i, MAX_N);
-        zps[i] = zp;
+        skip = 0;
+        est = err = est_t = 0.0;
+        sb_forks = sb_serial = 0;
+        if (samples > 0) {
+            est = (sym_bytes == 4)   ? lcs_oblivious_estimate<uint32_t>(i, &err)
+                  : (sym_bytes == 2) ? lcs_oblivious_estimate<uint16_t>(i, &err)
+                                     : lcs_oblivious_estimate<SYMBOL_TYPE>(i, &err);
+            est_t = get_wall_time() - start;
+            skip = (min_ratio <= 0.0) || (est + err < min_ratio);
+        }
+        if (skip)
+            zps[i] = -1;
+        else if (threshold > 0)
+            zps[i] = (sym_bytes == 4)   ? lcs_oblivious_decide<uint32_t>(i, MAX_N, &frac)
+                     : (sym_bytes == 2) ? lcs_oblivious_decide<uint16_t>(i, MAX_N, &frac)
+                                        : lcs_oblivious_decide<SYMBOL_TYPE>(i, MAX_N, &frac);
+        else if (length_only) {
+            if (score_type == SCORE_EDIT)
+                zps[i] = length_by_width<edit_score>(i);
+            else if (score_type == SCORE_WEIGHTED)
+                zps[i] = lcs_oblivious_length<weighted_score>(i);
+            else
+                zps[i] = length_by_width<lcs_score>(i);
+        } else {
+            packs.cnt = packs.raw_cnt = 0;
+            packs.bytes = packs.raw_bytes = packs.in_bytes = 0.0;
+            if (align_fp != NULL) align_spool_begin();
+            if (score_type == SCORE_EDIT)
+                oblivious_by_width<edit_score>(i);
+            else if (score_type == SCORE_WEIGHTED)
+                lcs_oblivious<weighted_score>(i);
+            else
+                oblivious_by_width<lcs_score>(i);
+            zps[i] = ctx.score;
+            if (align_fp != NULL) {
+                align_begin(i);
+                align_replay();
+                align_end(ctx.nx, ctx.ny);
+            }
+        }
         double end = get_wall_time();
         getrusage(RUSAGE_SELF, &ru[i + 1]);
 
@@ -530,6 +984,41 @@ int main(int argc, char *argv[]) {
         printf("  System time:             %.4f seconds (%s)\n", run_st, conv_sec(run_st, str));
         printf("  Total time:              %.4f seconds (%s)\n", run_tt, conv_sec(run_tt, str));
 
+        if (samples > 0) {
+            print_estimate(est, err, samples, nxs[i], nys[i], est_t);
+            if (skip && (min_ratio > 0.0)) printf("  Exact run:               skipped (below cutoff)\n");
+        }
+        if ((threshold > 0) && !skip) print_decision(threshold, answer, frac);
+        // only with --pack, so default runs keep their output
+        if (pack_forced && !length_only && !skip) {
+            printf("Snapshots:\n");
+            printf("  Bit-packed:              %lld of %lld, %.2f%% of the int size\n", packs.cnt,
+                   packs.cnt + packs.raw_cnt, 100.0 * (packs.bytes + packs.raw_bytes) / (max(1.0, packs.in_bytes)));
+        }
+        if ((snaps.tab != NULL) && !length_only && !skip) {
+            printf("Snapshot cache:\n");
+            printf("  Cached squares:          side >= %lld\n", snaps.min);
+            printf("  Hits:                    %lld of %lld (%.2f%%)\n", snaps.hits, snaps.lookups,
+                   (snaps.lookups > 0) ? 100.0 * snaps.hits / snaps.lookups : 0.0);
+            printf("  Cells saved:             %.0f (%.2f%% of mn)\n", snaps.saved,
+                   100.0 * snaps.saved / (max(1.0, (double)nxs[i] * nys[i])));
+        }
+
+        // only when 16-bit rows ran or --score-width was given, so default int runs keep their output
+        if ((threshold == 0) && !skip && ((score_bytes == sizeof(uint16_t)) || score_forced)) {
+            printf("Scores:\n");
+            printf("  Rows:                    %d-bit, %.1f MB peak resident\n", 8 * score_bytes,
+                   ru[i + 1].ru_maxrss / 1024.0);
+            printf("  Cell throughput:         %.1f M cells/s (m n / wall time)\n",
+                   (double)nxs[i] * nys[i] / (max(end - start, 1e-9)) / 1e6);
+        }
+
+        if ((sb_ncpu > 1) && !skip) {
+            printf("Scheduler:\n");
+            printf("  Forked sweeps:           %lld\n", (long long)sb_forks);
+            printf("  Kept serial:             %lld (pair over the shared cache)\n", (long long)sb_serial);
+        }
+
         print_proc_io();
         print_disk_io();  // Show disk I/O activity difference
         print_mem_data();
@@ -543,7 +1032,10 @@ int main(int argc, char *argv[]) {
 
     print_final_results(zps[r - 1], ut, st, tt, r, str);
 
+    align_close();
+    sb_free();
     free_memory(r);
+    tok_free();
 
     return 0;
 }
@@ -0,0 +1,650 @@
+/*
+Cache-oblivious LCS of three sequences, extending the SODA'06 recursion
+from the square to the cube.
+
+A block of the (nx + 1) x (ny + 1) x (nw + 1) DP cube is computed from its
+three input faces (the planes just below it in i, j and k) and produces its
+three output faces. Blocks are split into up to eight octants, processed in
+dependency order, with the three mid-planes holding the faces between them;
+only faces are ever stored, so space is O(n^2), and without knowing M the
+recursion reaches blocks whose faces fit in cache: O(n^3 / (B sqrt(M)))
+block transfers.
+
+Traceback recomputes the mid-planes of a block and then follows the path
+through the octants it crosses in reverse dependency order, recursing with
+their stored input faces. A monotone path meets at most four octants, so
+the total work stays O(n^3).
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "../include/util.h"
+
+#define DEFAULT_BASE 32
+
+#define MAX_ALPHABET_SIZE 256
+
+#define SYMBOL_TYPE char
+
+#define max(a, b) ((a) > (b)) ? (a) : (b)
+#define min(a, b) ((a) < (b)) ? (a) : (b)
+
+int BASE_N;
+
+SYMBOL_TYPE *X;
+SYMBOL_TYPE *Y;
+SYMBOL_TYPE *W;
+SYMBOL_TYPE *Z;
+
+int nx, ny, nw;
+
+int xp, yp, wp, zp;
+
+char **XS;
+char **YS;
+char **WS;
+
+int *nxs;
+int *nys;
+int *nws;
+
+int length_only;
+
+/* Face of a block: value at (a, b) is p[a * s + b]; p == NULL reads as 0 (input) or is not written (output). */
+typedef struct {
+    int *p;
+    int s;
+} face;
+
+/*
+Block with first cell (bi, bj, bk) and extent ni x nj x nk. Input faces
+fi, fj, fk lie on i = bi - 1, j = bj - 1, k = bk - 1, output faces gi, gj,
+gk on i = bi + ni - 1, ...; each face includes its low edges, so it is
+indexed from the block's low boundary in the two remaining coordinates.
+*/
+typedef struct {
+    int bi, bj, bk;
+    int ni, nj, nk;
+    face fi, fj, fk;
+    face gi, gj, gk;
+} cube;
+
+int *clen;
+
+int *arena;
+long long arena_top, arena_size;
+
+struct rusage *ru;
+int *zps;
+
+char alpha[MAX_ALPHABET_SIZE + 1];
+
+char *fname1;
+char *fname2;
+char *fname3;
+
+void free_memory(int r) {
+    int i;
+
+    if (Z != NULL) free(Z);
+
+    if (clen != NULL) free(clen);
+    if (arena != NULL) free(arena);
+
+    if (XS != NULL) {
+        for (i = 0; i < r; i++)
+            if (XS[i] != NULL) free(XS[i]);
+
+        free(XS);
+    }
+
+    if (YS != NULL) {
+        for (i = 0; i < r; i++)
+            if (YS[i] != NULL) free(YS[i]);
+
+        free(YS);
+    }
+
+    if (WS != NULL) {
+        for (i = 0; i < r; i++)
+            if (WS[i] != NULL) free(WS[i]);
+
+        free(WS);
+    }
+
+    if (nxs != NULL) free(nxs);
+    if (nys != NULL) free(nys);
+    if (nws != NULL) free(nws);
+
+    if (ru != NULL) free(ru);
+
+    if (zps != NULL) free(zps);
+}
+
+/* Arena words needed below a block: its mid-planes plus those of its largest octant. */
+long long arena_need(int ni, int nj, int nk) {
+    long long need = 0;
+
+    if ((ni <= BASE_N) && (nj <= BASE_N) && (nk <= BASE_N)) return 0;
+
+    if (ni > BASE_N) need += (nj + 1LL) * (nk + 1);
+    if (nj > BASE_N) need += (ni + 1LL) * (nk + 1);
+    if (nk > BASE_N) need += (ni + 1LL) * (nj + 1);
+
+    if (ni > BASE_N) ni -= ni / 2;
+    if (nj > BASE_N) nj -= nj / 2;
+    if (nk > BASE_N) nk -= nk / 2;
+
+    return need + arena_need(ni, nj, nk);
+}
+
+int allocate_memory(int m, int n, int o, int r, int b) {
+    int i, mm;
+
+    arena_size = arena_need(m, n, o) + (n + 1LL) * (o + 1);
+    arena = (int *)malloc(arena_size * sizeof(int));
+
+    clen = (int *)malloc((b + 1) * (b + 1) * (b + 1) * sizeof(int));
+
+    if (!length_only) {
+        mm = min(m, min(n, o));
+        Z = (SYMBOL_TYPE *)malloc((mm + 2) * sizeof(SYMBOL_TYPE));
+    }
+
+    XS = (char **)malloc((r) * sizeof(char *));
+    YS = (char **)malloc((r) * sizeof(char *));
+    WS = (char **)malloc((r) * sizeof(char *));
+
+    nxs = (int *)malloc((r) * sizeof(int));
+    nys = (int *)malloc((r) * sizeof(int));
+    nws = (int *)malloc((r) * sizeof(int));
+
+    ru = (struct rusage *)malloc((r + 1) * sizeof(struct rusage));
+    zps = (int *)malloc((r) * sizeof(int));
+
+    if ((arena == NULL) || (clen == NULL) || (!length_only && (Z == NULL)) || (XS == NULL) ||
+        (YS == NULL) || (WS == NULL) || (nxs == NULL) || (nys == NULL) || (nws == NULL) ||
+        (ru == NULL) || (zps == NULL)) {
+        printf("\nError: memory allocation failed!\n\n");
+        free_memory(r);
+        return 0;
+    }
+
+    for (i = 0; i < r; i++) {
+        XS[i] = (char *)malloc((m + 2) * sizeof(char));
+        YS[i] = (char *)malloc((n + 2) * sizeof(char));
+        WS[i] = (char *)malloc((o + 2) * sizeof(char));
+
+        if ((XS[i] == NULL) || (YS[i] == NULL) || (WS[i] == NULL)) {
+            printf("\nError: memory allocation failed!\n\n");
+            free_memory(r);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int read_data(int r) {
+    int i, d;
+
+    scanf("alphabet: %s\n\n", alpha);
+
+    for (i = 0; i < r; i++) {
+        if (scanf("sequence triple %d:\n\n", &d) != 1) return 0;
+        if (scanf("X = %s\n", XS[i] + 1) != 1) return 0;
+        nxs[i] = strlen(XS[i] + 1);
+        if (scanf("Y = %s\n", YS[i] + 1) != 1) return 0;
+        nys[i] = strlen(YS[i] + 1);
+        if (scanf("W = %s\n\n", WS[i] + 1) != 1) return 0;
+        nws[i] = strlen(WS[i] + 1);
+    }
+
+    return 1;
+}
+
+int read_seq_file(char *fname, char **S, int *ns, int r) {
+    int i;
+    FILE *fp;
+
+    if ((fp = fopen(fname, "r")) == NULL) return 0;
+    fscanf(fp, "%d\n", &i);
+    for (i = 0; i < r; i++) {
+        if (fscanf(fp, "%s\n", S[i] + 1) != 1) return 0;
+        ns[i] = strlen(S[i] + 1);
+    }
+    fclose(fp);
+
+    return 1;
+}
+
+int read_data_sep(int r) {
+    return read_seq_file(fname1, XS, nxs, r) && read_seq_file(fname2, YS, nys, r) &&
+           read_seq_file(fname3, WS, nws, r);
+}
+
+int get_len_sep(char *fname, int *m) {
+    FILE *fp;
+
+    if ((fp = fopen(fname, "r")) == NULL) return 0;
+    if (fscanf(fp, "%d", m) != 1) return 0;
+    fclose(fp);
+
+    return 1;
+}
+
+face sub_face(face f, int a, int b) {
+    face g;
+
+    g.p = (f.p != NULL) ? f.p + (long long)a * f.s + b : NULL;
+    g.s = f.s;
+
+    return g;
+}
+
+int *arena_alloc(long long words) {
+    int *p = arena + arena_top;
+
+    arena_top += words;
+
+    return p;
+}
+
+/*
+Splits c into its octants (fewer along dimensions already within the base
+size), in an order where every octant follows the ones it depends on. The
+mid-planes are taken from the arena; the caller releases them.
+*/
+int split_cube(cube *c, cube *ch) {
+    int hi, hj, hk, si, sj, sk, a, b, d, oi, oj, ok, q = 0;
+    face mi, mj, mk;
+
+    si = (c->ni > BASE_N);
+    sj = (c->nj > BASE_N);
+    sk = (c->nk > BASE_N);
+
+    hi = si ? c->ni / 2 : c->ni;
+    hj = sj ? c->nj / 2 : c->nj;
+    hk = sk ? c->nk / 2 : c->nk;
+
+    mi.p = si ? arena_alloc((c->nj + 1LL) * (c->nk + 1)) : NULL;
+    mi.s = c->nk + 1;
+    mj.p = sj ? arena_alloc((c->ni + 1LL) * (c->nk + 1)) : NULL;
+    mj.s = c->nk + 1;
+    mk.p = sk ? arena_alloc((c->ni + 1LL) * (c->nj + 1)) : NULL;
+    mk.s = c->nj + 1;
+
+    for (a = 0; a <= si; a++)
+        for (b = 0; b <= sj; b++)
+            for (d = 0; d <= sk; d++, q++) {
+                oi = a * hi;
+                oj = b * hj;
+                ok = d * hk;
+
+                ch[q].bi = c->bi + oi;
+                ch[q].bj = c->bj + oj;
+                ch[q].bk = c->bk + ok;
+                ch[q].ni = a ? c->ni - hi : hi;
+                ch[q].nj = b ? c->nj - hj : hj;
+                ch[q].nk = d ? c->nk - hk : hk;
+
+                ch[q].fi = sub_face(a ? mi : c->fi, oj, ok);
+                ch[q].fj = sub_face(b ? mj : c->fj, oi, ok);
+                ch[q].fk = sub_face(d ? mk : c->fk, oi, oj);
+
+                ch[q].gi = sub_face((a == si) ? c->gi : mi, oj, ok);
+                ch[q].gj = sub_face((b == sj) ? c->gj : mj, oi, ok);
+                ch[q].gk = sub_face((d == sk) ? c->gk : mk, oi, oj);
+            }
+
+    return q;
+}
+
+#define CIDX(a, b, d) (((a) * (c->nj + 1) + (b)) * (c->nk + 1) + (d))
+#define FACE(f, a, b) (((f).p != NULL) ? (f).p[(long long)(a) * (f).s + (b)] : 0)
+
+/* Base case: the whole block in clen, boundary layer included. */
+void cube_base(cube *c) {
+    int a, b, d, l, sa, sb, u, v;
+    SYMBOL_TYPE x, y;
+
+    sa = (c->nj + 1) * (c->nk + 1);
+    sb = c->nk + 1;
+
+    for (b = 0; b <= c->nj; b++)
+        for (d = 0; d <= c->nk; d++) clen[CIDX(0, b, d)] = FACE(c->fi, b, d);
+
+    for (a = 1; a <= c->ni; a++) {
+        for (d = 0; d <= c->nk; d++) clen[CIDX(a, 0, d)] = FACE(c->fj, a, d);
+        for (b = 1; b <= c->nj; b++) clen[CIDX(a, b, 0)] = FACE(c->fk, a, b);
+    }
+
+    for (a = 1; a <= c->ni; a++) {
+        x = X[c->bi + a - 1];
+        for (b = 1; b <= c->nj; b++) {
+            y = Y[c->bj + b - 1];
+            l = CIDX(a, b, 0);
+            for (d = 1; d <= c->nk; d++) {
+                if ((x == y) && (y == W[c->bk + d - 1]))
+                    clen[l + d] = clen[l + d - sa - sb - 1] + 1;
+                else {
+                    u = max(clen[l + d - sa], clen[l + d - sb]);
+                    v = clen[l + d - 1];
+                    clen[l + d] = max(u, v);
+                }
+            }
+        }
+    }
+
+    if (c->gi.p != NULL)
+        for (b = 0; b <= c->nj; b++)
+            for (d = 0; d <= c->nk; d++) c->gi.p[(long long)b * c->gi.s + d] = clen[CIDX(c->ni, b, d)];
+
+    if (c->gj.p != NULL)
+        for (a = 0; a <= c->ni; a++)
+            for (d = 0; d <= c->nk; d++) c->gj.p[(long long)a * c->gj.s + d] = clen[CIDX(a, c->nj, d)];
+
+    if (c->gk.p != NULL)
+        for (a = 0; a <= c->ni; a++)
+            for (b = 0; b <= c->nj; b++) c->gk.p[(long long)a * c->gk.s + b] = clen[CIDX(a, b, c->nk)];
+}
+
+void cube_forward(cube *c) {
+    cube ch[8];
+    long long mark;
+    int q, n;
+
+    if ((c->ni <= BASE_N) && (c->nj <= BASE_N) && (c->nk <= BASE_N)) {
+        cube_base(c);
+        return;
+    }
+
+    mark = arena_top;
+    n = split_cube(c, ch);
+    for (q = 0; q < n; q++) cube_forward(&ch[q]);
+    arena_top = mark;
+}
+
+int inside(cube *c) {
+    return (xp >= c->bi) && (xp < c->bi + c->ni) && (yp >= c->bj) && (yp < c->bj + c->nj) &&
+           (wp >= c->bk) && (wp < c->bk + c->nk);
+}
+
+/* Follows the path from (xp, yp, wp) until it leaves c through an input face. */
+void cube_trace(cube *c) {
+    cube ch[8];
+    long long mark;
+    int q, n, a, b, d, v;
+
+    if ((c->ni <= BASE_N) && (c->nj <= BASE_N) && (c->nk <= BASE_N)) {
+        cube_base(c);
+
+        a = xp - c->bi + 1;
+        b = yp - c->bj + 1;
+        d = wp - c->bk + 1;
+
+        while ((a > 0) && (b > 0) && (d > 0)) {
+            v = clen[CIDX(a, b, d)];
+            if ((X[xp] == Y[yp]) && (Y[yp] == W[wp])) {
+                Z[zp++] = X[xp];
+                a--, b--, d--;
+                xp--, yp--, wp--;
+            } else if (clen[CIDX(a - 1, b, d)] == v) {
+                a--;
+                xp--;
+            } else if (clen[CIDX(a, b - 1, d)] == v) {
+                b--;
+                yp--;
+            } else {
+                d--;
+                wp--;
+            }
+        }
+
+        return;
+    }
+
+    mark = arena_top;
+    n = split_cube(c, ch);
+
+    // the last octant only feeds c's own output faces
+    for (q = 0; q < n - 1; q++) cube_forward(&ch[q]);
+
+    for (q = n - 1; q >= 0; q--)
+        if (inside(&ch[q])) cube_trace(&ch[q]);
+
+    arena_top = mark;
+}
+
+void root_cube(cube *c) {
+    c->bi = c->bj = c->bk = 1;
+    c->ni = nx;
+    c->nj = ny;
+    c->nk = nw;
+
+    c->fi.p = c->fj.p = c->fk.p = NULL;
+    c->gi.p = c->gj.p = c->gk.p = NULL;
+    c->fi.s = c->gi.s = nw + 1;
+    c->fj.s = c->gj.s = nw + 1;
+    c->fk.s = c->gk.s = ny + 1;
+
+    arena_top = 0;
+}
+
+void copy_seq(int j) {
+    nx = nxs[j];
+    ny = nys[j];
+    nw = nws[j];
+
+    X = XS[j];
+    Y = YS[j];
+    W = WS[j];
+}
+
+void lcs_oblivious3(int r) {
+    cube c;
+
+    copy_seq(r);
+    root_cube(&c);
+
+    xp = nx;
+    yp = ny;
+    wp = nw;
+    zp = 0;
+
+    if ((nx > 0) && (ny > 0) && (nw > 0)) cube_trace(&c);
+}
+
+/* Length only: one forward sweep, keeping just the root's output face on i = nx. */
+int lcs_oblivious3_length(int r) {
+    cube c;
+
+    copy_seq(r);
+    root_cube(&c);
+
+    c.gi.p = arena_alloc((ny + 1LL) * (nw + 1));
+    cube_forward(&c);
+
+    return c.gi.p[(long long)ny * (nw + 1) + nw];
+}
+
+int find_rec_LCS(void) {
+    int i, j;
+    SYMBOL_TYPE s;
+
+    Z[zp] = 0;
+
+    for (i = 0, j = zp - 1; i < j; i++, j--) {
+        s = Z[i];
+        Z[i] = Z[j];
+        Z[j] = s;
+    }
+
+    printf("LCS Length = %d\n", zp);
+    printf("LCS = ");
+    for (i = 0; i < zp; i++) printf("%c", Z[i]);
+    printf("\n\n");
+
+    return zp;
+}
+
+int is_subseq(SYMBOL_TYPE *S, int ns) {
+    int i, j;
+
+    for (i = j = 1; j <= zp; j++, i++) {
+        while ((i <= ns) && (Z[j - 1] != S[i])) i++;
+        if (i > ns) return 0;
+    }
+
+    return 1;
+}
+
+void verify(void) {
+    printf("%s in X!!!\n", is_subseq(X, nx) ? "Found" : "Not Found");
+    printf("%s in Y!!!\n", is_subseq(Y, ny) ? "Found" : "Not Found");
+    printf("%s in W!!!\n\n", is_subseq(W, nw) ? "Found" : "Not Found");
+}
+
+int main(int argc, char *argv[]) {
+    int i, l, m, n, o, r, b, prn;
+    double ut, st, tt;
+    char str[50];
+
+    printf(
+        "=====================================================================================\n");
+    printf("Program: %s\n", argv[0]);
+
+    for (i = l = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--length-only") == 0)
+            length_only = 1;
+        else
+            argv[l++] = argv[i];
+    }
+    argc = l;
+
+    if (argc < 3) {
+        printf("\nError: not enough arguments!\n");
+        printf("Specify: n ( = length of sequences ) and r ( = number of runs ),\n");
+        printf("         or -1 f1 f2 f3 r ( = one sequence file per species ).\n\n");
+        printf("Options: --length-only ( = report the LCS length without reconstructing it ).\n\n");
+        return 0;
+    }
+
+    n = atoi(argv[1]);
+    if (n == -1) {
+        if (argc < 6) {
+            printf("\nError: not enough arguments!\n");
+            return 0;
+        }
+        fname1 = argv[2];
+        fname2 = argv[3];
+        fname3 = argv[4];
+        b = 3;
+    } else
+        b = 0;
+    r = atoi(argv[b + 2]);
+    m = o = n;
+
+    if (n == 0) {
+        if (scanf("%d %d %d\n\n", &m, &n, &o) != 3) {
+            printf("\nError: cannot read sequence lengths!\n");
+            return 0;
+        }
+    } else if (n == -1) {
+        if (!get_len_sep(fname1, &m) || !get_len_sep(fname2, &n) || !get_len_sep(fname3, &o)) {
+            printf("\nError: cannot read sequence lengths!\n");
+            return 0;
+        }
+    }
+
+    if (argc > b + 3) {
+        BASE_N = atoi(argv[b + 3]);
+        if (BASE_N <= 0) BASE_N = DEFAULT_BASE;
+    } else
+        BASE_N = DEFAULT_BASE;
+
+    if (argc > b + 4)
+        prn = atoi(argv[b + 4]);
+    else
+        prn = 0;
+
+    if (!allocate_memory(m, n, o, r, BASE_N)) return 0;
+
+    if (b == 0) {
+        if (!read_data(r)) {
+            printf("\nError: failed to read data!\n\n");
+            free_memory(r);
+            return 0;
+        }
+    } else {
+        if (!read_data_sep(r)) {
+            printf("\nError: failed to read data!\n\n");
+            free_memory(r);
+            return 0;
+        }
+    }
+
+    printf("m = %d, n = %d, o = %d\n", m, n, o);
+    printf("Runs = %d, base case = %d\n", r, BASE_N);
+    printf("Face storage: %.1f MB\n", arena_size * sizeof(int) / (1024.0 * 1024.0));
+    if (length_only) printf("Mode: length only\n");
+
+    getrusage(RUSAGE_SELF, &ru[0]);
+
+    for (i = 0; i < r; i++) {
+        init_disk_io();  // Initialize disk I/O counters
+        init_page_faults();  // Initialize page fault counters
+        double start = get_wall_time();
+        if (length_only)
+            zps[i] = lcs_oblivious3_length(i);
+        else {
+            lcs_oblivious3(i);
+            zps[i] = zp;
+        }
+        double end = get_wall_time();
+        getrusage(RUSAGE_SELF, &ru[i + 1]);
+
+        printf("\n");
+        printf("RUN %d RESULTS\n", i + 1);
+        printf("Time:\n");
+        printf("  Wall time:               %.4f seconds (%s)\n", end - start, conv_sec(end - start, str));
+
+        double run_ut = ru[i + 1].ru_utime.tv_sec + (ru[i + 1].ru_utime.tv_usec * 0.000001) -
+                        (ru[i].ru_utime.tv_sec + (ru[i].ru_utime.tv_usec * 0.000001));
+        double run_st = ru[i + 1].ru_stime.tv_sec + (ru[i + 1].ru_stime.tv_usec * 0.000001) -
+                        (ru[i].ru_stime.tv_sec + (ru[i].ru_stime.tv_usec * 0.000001));
+        double run_tt = run_ut + run_st;
+
+        printf("  User time:               %.4f seconds (%s)\n", run_ut, conv_sec(run_ut, str));
+        printf("  System time:             %.4f seconds (%s)\n", run_st, conv_sec(run_st, str));
+        printf("  Total time:              %.4f seconds (%s)\n", run_tt, conv_sec(run_tt, str));
+
+        if (prn && !length_only) {
+            printf("\n");
+            find_rec_LCS();
+            verify();
+        }
+
+        print_proc_io();
+        print_disk_io();  // Show disk I/O activity difference
+        print_mem_data();
+    }
+
+    ut = ru[r].ru_utime.tv_sec + (ru[r].ru_utime.tv_usec * 0.000001) -
+         (ru[0].ru_utime.tv_sec + (ru[0].ru_utime.tv_usec * 0.000001));
+    st = ru[r].ru_stime.tv_sec + (ru[r].ru_stime.tv_usec * 0.000001) -
+         (ru[0].ru_stime.tv_sec + (ru[0].ru_stime.tv_usec * 0.000001));
+    tt = ut + st;
+
+    print_final_results(zps[r - 1], ut, st, tt, r, str);
+
+    free_memory(r);
+
+    return 0;
+}
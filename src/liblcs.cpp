@@ -0,0 +1,208 @@
+/*
+liblcs: lcs_hirschberg's ALG_C (include/hirschberg.h) and lcs_oblivious's
+rec_LCS (include/oblivious.h) on the caller's lcs_ctx (include/lcs_ctx.h;
+API in include/liblcs.h). The kernels are the binaries' own, so each
+engine returns the LCS and matches its binary writes for the pair with the
+default options: the classic two-scan split for LCS_HIRSCHBERG, and no
+snapshot cache for LCS_OBLIVIOUS. Scans use match-mask rows when the pair
+has at most ALPHA_MAX_KERNEL distinct symbols.
+
+The kernels read the pair in place from the caller's buffers (ALG_C's
+backward scans through reverse iterators over them), so nothing is
+copied; Z goes to the context's seq scratch, the score rows to rows, the
+base-case table and its matches to tab, and rec_LCS's boundary stacks to
+bufs.
+
+The headers' helpers and globals (sb_*, alpha_*, pack_*, util.h, ...) are
+built hidden and made local by the Makefile, and the binaries' globals
+that they read (sb_lo / sb_hi, pack_on) keep their defaults, so the
+object exports only the LCS_API functions.
+*/
+
+#include <limits.h>
+#include <stdint.h>
+
+#include "../include/util.h"
+#include "../include/bitpack.h"
+#include "../include/spacebound.h"
+#include "../include/alphabet.h"
+#include "../include/liblcs.h"
+#include "../include/lcs_ctx.h"
+#include "../include/hirschberg.h"
+#include "../include/oblivious.h"
+
+#define LCS_DEFAULT_BASE 32
+
+/* lcs_emit keeps the matches in mpos; the kernels only test match for whether to emit them. */
+static void keep_match(struct lcs_ctx *c, INDEX_TYPE i, INDEX_TYPE j) {}
+
+/* Checks the arguments, points the context at the pair, codes its symbols and makes room for Z and rows ints. */
+static long long begin(lcs_ctx *c, const char *x, long long m, const char *y, long long n, long long rows) {
+    long long mm = (m < n) ? m : n;
+
+    if ((c == NULL) || (m < 0) || (n < 0) || ((m > 0) && (x == NULL)) || ((n > 0) && (y == NULL)) ||
+        (mm > INT_MAX))
+        return LCS_EINVAL;
+
+    if (!lcs_reserve(c, &c->seq, mm + 2) || !lcs_reserve(c, &c->rows, rows * sizeof(int))) return LCS_ENOMEM;
+
+    // the kernels only read X and Y
+    c->Z = (char *)c->seq.p;
+    c->X = (char *)x;
+    c->Y = (char *)y;
+    c->nx = m;
+    c->ny = n;
+
+    alpha_reset(&c->codes);
+    alpha_add(&c->codes, x, m);
+    alpha_add(&c->codes, y, n);
+    alpha_select(&c->codes, ALPHA_AUTO);
+    c->alpha = &c->codes;
+
+    return 0;
+}
+
+/* rec_LCS's rlen (in rows), boundary stacks and base-case table for an m x n pair; 0 if out of memory. */
+static int oblivious_scratch(lcs_ctx *c, long long m, long long n) {
+    long long f = 3 * (m + n) + 256;
+
+    if (!lcs_reserve(c, &c->bufs, 3 * f * sizeof(int)) ||
+        !lcs_reserve(c, &c->tab, (size_t)(c->base + 1) * (c->base + 1) * sizeof(int)))
+        return 0;
+
+    c->rlen = (int *)c->rows.p;
+    c->diag0 = n + 1;
+    c->buf_up = (int *)c->bufs.p;
+    c->buf_left = c->buf_up + f;
+    c->buf_up_left = c->buf_left + f;
+    c->blen = (int *)c->tab.p;
+
+    return 1;
+}
+
+lcs_ctx *lcs_create(const lcs_config *cfg) {
+    lcs_alloc a = lcs_sys;
+    lcs_ctx *c;
+
+    if ((cfg != NULL) && (cfg->alloc != NULL)) {
+        if ((cfg->alloc->alloc == NULL) || (cfg->alloc->release == NULL)) return NULL;
+        a = *cfg->alloc;
+    }
+    if ((cfg != NULL) && (((cfg->engine != LCS_HIRSCHBERG) && (cfg->engine != LCS_OBLIVIOUS)) || (cfg->base < 0)))
+        return NULL;
+
+    if ((c = (lcs_ctx *)a.alloc(sizeof(lcs_ctx), a.user)) == NULL) return NULL;
+    memset(c, 0, sizeof(lcs_ctx));
+
+    c->a = a;
+    c->engine = (cfg != NULL) ? cfg->engine : LCS_HIRSCHBERG;
+    c->base = ((cfg != NULL) && (cfg->base > 0)) ? cfg->base : LCS_DEFAULT_BASE;
+    c->base_kernel = base_slot(c->base);
+    c->score_auto = 1;
+    c->split_mode = SPLIT_CLASSIC;
+
+    return c;
+}
+
+void lcs_destroy(lcs_ctx *c) {
+    if (c == NULL) return;
+
+    lcs_unreserve(c, &c->seq);
+    lcs_unreserve(c, &c->rows);
+    lcs_unreserve(c, &c->tab);
+    lcs_unreserve(c, &c->bufs);
+    lcs_unreserve(c, &c->masks);
+    lcs_unreserve(c, &c->cuts);
+    c->a.release(c, sizeof(lcs_ctx), c->a.user);
+}
+
+long long lcs_length(lcs_ctx *c, const char *x, long long m, const char *y, long long n) {
+    long long e;
+    int *T;
+
+    if (c == NULL) return LCS_EINVAL;
+
+    if (c->engine == LCS_HIRSCHBERG) {
+        if ((e = begin(c, x, m, y, n, 3 * (n + 2))) < 0) return e;
+
+        T = (int *)c->rows.p;
+        c->K[0] = T;
+        c->K[1] = T + (n + 2);
+        c->L1 = T + 2 * (n + 2);
+        ALG_B(c, m, n, c->X, c->Y, c->L1);
+
+        return c->L1[n];
+    }
+
+    if ((e = begin(c, x, m, y, n, m + n + 3)) < 0) return e;
+
+    c->rlen = (int *)c->rows.p;
+    c->diag0 = n + 1;
+
+    return ((min(m, n)) < SCORE16_LIMIT) ? rec_length<lcs_score<char, uint16_t> >(c)
+                                         : rec_length<lcs_score<char, int> >(c);
+}
+
+long long lcs_align(lcs_ctx *c, const char *x, long long m, const char *y, long long n, char *z,
+                    long long *pairs) {
+    long long e, i, j, t;
+    int *T;
+
+    if (c == NULL) return LCS_EINVAL;
+
+    if (c->engine == LCS_HIRSCHBERG) {
+        if ((e = begin(c, x, m, y, n, 4 * (n + 2))) < 0) return e;
+        if (!lcs_reserve(c, &c->tab, (size_t)(c->base + 1) * (c->base + 1) * sizeof(int) +
+                                         2 * (c->base + 1) * sizeof(INDEX_TYPE)))
+            return LCS_ENOMEM;
+
+        T = (int *)c->rows.p;
+        c->L1 = T;
+        c->L2 = T + (n + 2);
+        c->K[0] = T + 2 * (n + 2);
+        c->K[1] = T + 3 * (n + 2);
+        c->apos = (INDEX_TYPE *)c->tab.p;
+        c->clen = (int *)(c->apos + 2 * (c->base + 1));
+    } else {
+        if ((e = begin(c, x, m, y, n, m + n + 3)) < 0) return e;
+        if (!oblivious_scratch(c, m, n)) return LCS_ENOMEM;
+    }
+
+    c->mpos = pairs;
+    c->mp = 0;
+    c->match = (pairs != NULL) ? keep_match : NULL;
+    c->zp = 0;
+
+    if (c->engine == LCS_HIRSCHBERG) {
+        ALG_C_fit<char, int>(c, m, n, c->X, c->Y, std::reverse_iterator<char *>(c->X + m),
+                             std::reverse_iterator<char *>(c->Y + n));
+
+        // Z from Z[1], left to right
+        if (z != NULL) memcpy(z, c->Z + 1, c->zp);
+    } else {
+        if ((min(m, n)) < SCORE16_LIMIT)
+            rec_align<lcs_score<char, uint16_t> >(c);
+        else
+            rec_align<lcs_score<char, int> >(c);
+
+        // Z from Z[0] and the matches, right to left
+        if (z != NULL)
+            for (i = 0; i < c->zp; i++) z[i] = c->Z[c->zp - 1 - i];
+        for (i = 0, j = c->mp - 2; i < j; i += 2, j -= 2) {
+            t = pairs[i];
+            pairs[i] = pairs[j];
+            pairs[j] = t;
+            t = pairs[i + 1];
+            pairs[i + 1] = pairs[j + 1];
+            pairs[j + 1] = t;
+        }
+    }
+
+    // the kernels' matches are 1-based
+    for (i = 0; i < c->mp; i++) pairs[i]--;
+
+    c->mpos = NULL;
+    c->match = NULL;
+
+    return c->zp;
+}
@@ -0,0 +1,286 @@
+/*
+liblcs against the binaries (make test, from the top directory).
+
+Random pairs, over alphabets below and above ALPHA_MAX_KERNEL and with
+specialized and generic base cases, go through bin/lcs_hirschberg and
+bin/lcs_oblivious with --align; each engine's lcs_align must return the
+matches its binary writes, and lcs_length the same length. All scratch
+comes from a counting allocator that must be back to zero after
+lcs_destroy, and that fails every allocation in turn to check that
+LCS_ENOMEM is returned without leaks. Finally two threads run every pair
+on contexts of their own and must reproduce the sequential results.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+
+#include "../include/liblcs.h"
+
+#define PAIRS 8
+#define THREADS 2
+
+#define TEST_IN "bin/liblcs_test.in"
+#define TEST_ALN "bin/liblcs_test.aln"
+
+struct pair {
+    long long m, n;
+    int base;
+    const char *alpha;
+    char *x, *y;
+    long long len[2], *pos[2];  // per engine: the LCS length and its matches
+};
+
+// m, n, base case, alphabet
+struct pair pairs[PAIRS] = {
+    {1, 1, 32, "AC"},
+    {7, 300, 32, "ACGT"},
+    {300, 257, 32, "ACGT"},
+    {1000, 700, 64, "ACGT"},
+    {2500, 2600, 32, "ABCDEFGHIJKLMNOPQRSTUVWXYZ"},
+    {1800, 1500, 7, "ABCDEFGHIJKLMNOPQRSTUVWXYZ"},
+    {2000, 2100, 32, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"},
+    {3000, 64, 128, "01"},
+};
+
+const char *engine_names[] = {"hirschberg", "oblivious"};
+
+struct counter {
+    std::atomic<long long> live;
+    long long calls, fail_at;  // fail_at > 0: the fail_at-th call returns NULL
+};
+
+void *count_alloc(size_t bytes, void *user) {
+    struct counter *k = (struct counter *)user;
+
+    if (++k->calls == k->fail_at) return NULL;
+    k->live += bytes;
+
+    return malloc(bytes);
+}
+
+void count_release(void *p, size_t bytes, void *user) {
+    ((struct counter *)user)->live -= bytes;
+    free(p);
+}
+
+void random_seq(char *s, long long n, const char *alpha) {
+    long long i, a = strlen(alpha);
+
+    for (i = 0; i < n; i++) s[i] = alpha[rand() % a];
+    s[n] = 0;
+}
+
+/* The binary's matches for pair p into pos (1-based), from --align; their count, -1 on failure. */
+long long run_binary(int e, struct pair *p, long long *pos) {
+    char cmd[256], line[128];
+    long long k = 0, i, j;
+    FILE *fp;
+
+    if ((fp = fopen(TEST_IN, "w")) == NULL) return -1;
+    fprintf(fp, "%lld %lld\n\nalphabet: %s\n\nsequence pair 1:\n\nX = %s\nY = %s\n\n", p->m, p->n, p->alpha, p->x,
+            p->y);
+    fclose(fp);
+
+    sprintf(cmd, "bin/lcs_%s 0 1 %d 0 --align=%s < %s > /dev/null", engine_names[e], p->base, TEST_ALN, TEST_IN);
+    if (system(cmd) != 0) return -1;
+
+    if ((fp = fopen(TEST_ALN, "r")) == NULL) return -1;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%lld %lld", &i, &j) != 2) break;
+        pos[k++] = i;
+        pos[k++] = j;
+    }
+    fclose(fp);
+
+    return k / 2;
+}
+
+/* lcs_length and lcs_align of pair p on c, checked against the stored results of engine e; 1 if they agree. */
+int check_pair(lcs_ctx *c, int e, struct pair *p, char *z, long long *pos) {
+    long long l, i;
+
+    if ((l = lcs_length(c, p->x, p->m, p->y, p->n)) != p->len[e]) return 0;
+    if ((l = lcs_align(c, p->x, p->m, p->y, p->n, z, pos)) != p->len[e]) return 0;
+
+    for (i = 0; i < l; i++)
+        if ((pos[2 * i] != p->pos[e][2 * i] - 1) || (pos[2 * i + 1] != p->pos[e][2 * i + 1] - 1) ||
+            (z[i] != p->x[pos[2 * i]]))
+            return 0;
+
+    return 1;
+}
+
+int test_binaries(void) {
+    struct counter k = {{0}, 0, 0};
+    lcs_alloc a = {count_alloc, count_release, &k};
+    lcs_config cfg;
+    lcs_ctx *c;
+    long long *pos;
+    char *z;
+    int e, i;
+
+    for (i = 0; i < PAIRS; i++) {
+        struct pair *p = &pairs[i];
+
+        p->x = (char *)malloc(p->m + 1);
+        p->y = (char *)malloc(p->n + 1);
+        random_seq(p->x, p->m, p->alpha);
+        random_seq(p->y, p->n, p->alpha);
+
+        for (e = 0; e < 2; e++) {
+            p->pos[e] = (long long *)malloc(2 * (p->m + p->n) * sizeof(long long));
+            if ((p->len[e] = run_binary(e, p, p->pos[e])) < 0) {
+                printf("\nError: bin/lcs_%s failed on pair %d!\n", engine_names[e], i + 1);
+                return 0;
+            }
+
+            cfg.engine = e;
+            cfg.base = p->base;
+            cfg.alloc = &a;
+            z = (char *)malloc(p->m + 1);
+            pos = (long long *)malloc(2 * (p->m + 1) * sizeof(long long));
+            c = lcs_create(&cfg);
+
+            if ((c == NULL) || !check_pair(c, e, p, z, pos)) {
+                printf("\nError: liblcs %s differs from its binary on pair %d!\n", engine_names[e], i + 1);
+                return 0;
+            }
+
+            lcs_destroy(c);
+            free(z);
+            free(pos);
+
+            if (k.live != 0) {
+                printf("\nError: liblcs %s leaves %lld bytes after lcs_destroy!\n", engine_names[e],
+                       (long long)k.live);
+                return 0;
+            }
+        }
+
+        printf("pair %d (%lld x %lld, %d symbols, base %d): LCS %lld, matches as the binaries\n", i + 1, p->m, p->n,
+               (int)strlen(p->alpha), p->base, p->len[0]);
+    }
+
+    remove(TEST_IN);
+    remove(TEST_ALN);
+
+    return 1;
+}
+
+/* Fails each allocation of a create / align / length / destroy cycle in turn. */
+int test_out_of_memory(void) {
+    struct counter k = {{0}, 0, 0};
+    lcs_alloc a = {count_alloc, count_release, &k};
+    lcs_config cfg = {0, 32, &a};
+    struct pair *p = &pairs[4];
+    long long f, l, n, pos[2 * 2600];
+    char z[2600];
+    lcs_ctx *c;
+    int e;
+
+    for (e = 0; e < 2; e++) {
+        cfg.engine = e;
+
+        // the allocations of a full cycle, then each one failing
+        k.calls = k.fail_at = 0;
+        c = lcs_create(&cfg);
+        lcs_align(c, p->x, p->m, p->y, p->n, z, pos);
+        lcs_length(c, p->x, p->m, p->y, p->n);
+        lcs_destroy(c);
+        n = k.calls;
+
+        for (f = 1; f <= n; f++) {
+            k.calls = 0;
+            k.fail_at = f;
+            if ((c = lcs_create(&cfg)) != NULL) {
+                l = lcs_align(c, p->x, p->m, p->y, p->n, z, pos);
+                if ((l != p->len[e]) && (l != LCS_ENOMEM)) {
+                    printf("\nError: liblcs %s returns %lld with allocation %lld failing!\n", engine_names[e], l,
+                           f);
+                    return 0;
+                }
+                l = lcs_length(c, p->x, p->m, p->y, p->n);
+                if ((l != p->len[e]) && (l != LCS_ENOMEM)) {
+                    printf("\nError: liblcs %s returns %lld with allocation %lld failing!\n", engine_names[e], l,
+                           f);
+                    return 0;
+                }
+                lcs_destroy(c);
+            }
+            if (k.live != 0) {
+                printf("\nError: liblcs %s leaks %lld bytes with allocation %lld failing!\n", engine_names[e],
+                       (long long)k.live, f);
+                return 0;
+            }
+        }
+
+        printf("%s: each of %lld allocations failed in turn, no leaks\n", engine_names[e], n);
+    }
+
+    k.fail_at = 0;
+    if (((c = lcs_create(NULL)) == NULL) || (lcs_length(NULL, p->x, 1, p->y, 1) != LCS_EINVAL) ||
+        (lcs_length(c, p->x, -1, p->y, 1) != LCS_EINVAL) || (lcs_align(c, p->x, 0, p->y, p->n, z, pos) != 0)) {
+        printf("\nError: liblcs misreports invalid or empty input!\n");
+        return 0;
+    }
+    lcs_destroy(c);
+
+    return 1;
+}
+
+void thread_run(int t, int *ok) {
+    struct counter k = {{0}, 0, 0};
+    lcs_alloc a = {count_alloc, count_release, &k};
+    lcs_config cfg[2] = {{LCS_HIRSCHBERG, 0, &a}, {LCS_OBLIVIOUS, 0, &a}};
+    lcs_ctx *c[2];
+    long long pos[2 * 3001];
+    char z[3001];
+    int e, i, p;
+
+    *ok = 1;
+    for (i = 0; i < PAIRS; i++) {
+        p = (i + t) % PAIRS;  // the threads run different pairs at the same time
+        for (e = 0; e < 2; e++) {
+            cfg[e].base = pairs[p].base;
+            c[e] = lcs_create(&cfg[e]);
+            if ((c[e] == NULL) || !check_pair(c[e], e, &pairs[p], z, pos)) *ok = 0;
+            lcs_destroy(c[e]);
+        }
+    }
+
+    if (k.live != 0) *ok = 0;
+}
+
+int test_threads(void) {
+    std::thread th[THREADS];
+    int t, ok[THREADS];
+
+    for (t = 0; t < THREADS; t++) th[t] = std::thread(thread_run, t, &ok[t]);
+    for (t = 0; t < THREADS; t++) th[t].join();
+
+    for (t = 0; t < THREADS; t++)
+        if (!ok[t]) {
+            printf("\nError: thread %d differs from the sequential results!\n", t + 1);
+            return 0;
+        }
+
+    printf("%d threads on separate contexts: same results as sequential\n", THREADS);
+
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    srand(2006);
+
+    if (!test_binaries() || !test_out_of_memory() || !test_threads()) return 1;
+
+    printf("liblcs: all tests passed\n");
+
+    return 0;
+}